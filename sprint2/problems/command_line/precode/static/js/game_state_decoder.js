@@ -0,0 +1,45 @@
+// Reference decoder for the packed game state frame (Accept: application/x-game-state).
+// Frame layout, little-endian: "GST1", u64 tick, u32 count,
+// then count records of u32 id, f64 x, f64 y, f64 vx, f64 vy, u8 dir.
+// Returns the same shape as the JSON /api/v1/game/state response plus 'tick'.
+const GAME_STATE_MAGIC = 'GST1';
+const GAME_STATE_HEADER_SIZE = 16;
+const GAME_STATE_RECORD_SIZE = 37;
+
+function decodeGameState(buffer) {
+  const view = new DataView(buffer);
+  const magic = String.fromCharCode(
+    view.getUint8(0), view.getUint8(1), view.getUint8(2), view.getUint8(3));
+  if (magic !== GAME_STATE_MAGIC) {
+    throw new Error('Unexpected game state frame: ' + magic);
+  }
+
+  const tick = Number(view.getBigUint64(4, true));
+  const count = view.getUint32(12, true);
+  const players = {};
+
+  let offset = GAME_STATE_HEADER_SIZE;
+  for (let i = 0; i < count; ++i, offset += GAME_STATE_RECORD_SIZE) {
+    const id = view.getUint32(offset, true);
+    players[id] = {
+      pos: [view.getFloat64(offset + 4, true), view.getFloat64(offset + 12, true)],
+      speed: [view.getFloat64(offset + 20, true), view.getFloat64(offset + 28, true)],
+      dir: String.fromCharCode(view.getUint8(offset + 36)),
+    };
+  }
+
+  return { tick: tick, players: players };
+}
+
+// Fetches the state as a binary frame; 'since' is optional and requests only changed dogs
+function fetchGameState(authToken, since) {
+  const url = since === undefined ? '/api/v1/game/state' : '/api/v1/game/state?since=' + since;
+  return fetch(url, {
+    headers: {
+      'Accept': 'application/x-game-state',
+      'Authorization': 'Bearer ' + authToken,
+    },
+  })
+    .then(response => response.arrayBuffer())
+    .then(decodeGameState);
+}
@@ -0,0 +1,115 @@
+// Сравнение Map::ClampPosition с пространственным индексом и без него на сгенерированной карте.
+// Город — сетка кварталов: каждая сторона квартала отдельная дорога, в каждом квартале здание.
+//
+//     spatial_index_bench [blocks] [queries]
+//
+// По умолчанию 85 x 85 кварталов (14 620 дорог) и 200 000 перемещений
+#include "map.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+    constexpr model::Coord BLOCK = 10;
+
+    struct Move {
+        double old_x, old_y, new_x, new_y;
+    };
+
+    void FillCity(model::Map& map, int blocks) {
+        const model::Coord size = blocks * BLOCK;
+        for (model::Coord line = 0; line <= size; line += BLOCK) {
+            for (model::Coord from = 0; from < size; from += BLOCK) {
+                map.AddRoad({ model::Road::HORIZONTAL, { from, line }, from + BLOCK });
+                map.AddRoad({ model::Road::VERTICAL, { line, from }, from + BLOCK });
+            }
+        }
+        for (model::Coord x = 0; x < size; x += BLOCK) {
+            for (model::Coord y = 0; y < size; y += BLOCK) {
+                map.AddBuilding(model::Building{ { { x + 2, y + 2 }, { BLOCK - 4, BLOCK - 4 } } });
+            }
+        }
+    }
+
+    // Собака стоит в случайной точке дороги и пытается сдвинуться вдоль одной из осей
+    std::vector<Move> MakeMoves(const model::Map& map, size_t count) {
+        std::mt19937_64 random{ 42 };
+        const auto& roads = map.GetRoads();
+        std::uniform_int_distribution<size_t> road_dist{ 0, roads.size() - 1 };
+        std::uniform_real_distribution<double> unit{ 0.0, 1.0 };
+        std::uniform_real_distribution<double> step{ -3.0 * BLOCK, 3.0 * BLOCK };
+
+        std::vector<Move> moves;
+        moves.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            const auto& road = roads[road_dist(random)];
+            const auto start = road.GetStart();
+            const auto end = road.GetEnd();
+            const double t = unit(random);
+            const double x = start.x + (end.x - start.x) * t;
+            const double y = start.y + (end.y - start.y) * t;
+            const double d = step(random);
+            moves.push_back(unit(random) < 0.5 ? Move{ x, y, x + d, y } : Move{ x, y, x, y + d });
+        }
+        return moves;
+    }
+
+    template <typename Fn>
+    double MeasureNsPerCall(size_t count, Fn&& fn) {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        return std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(count);
+    }
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+    const int blocks = argc > 1 ? std::atoi(argv[1]) : 85;
+    const size_t queries = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 200'000;
+    if (blocks <= 0 || queries == 0) {
+        std::cerr << "Usage: spatial_index_bench [blocks] [queries]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    model::Map linear{ model::Map::Id{ "linear" }, "linear" };
+    model::Map indexed{ model::Map::Id{ "indexed" }, "indexed" };
+    FillCity(linear, blocks);
+    FillCity(indexed, blocks);
+    indexed.BuildIndex();
+
+    const auto moves = MakeMoves(indexed, queries);
+    std::vector<std::pair<double, double>> linear_result(moves.size());
+    std::vector<std::pair<double, double>> indexed_result(moves.size());
+
+    const double linear_ns = MeasureNsPerCall(moves.size(), [&] {
+        for (size_t i = 0; i < moves.size(); ++i) {
+            const auto& m = moves[i];
+            linear_result[i] = linear.ClampPosition(m.old_x, m.old_y, m.new_x, m.new_y);
+        }
+    });
+    const double indexed_ns = MeasureNsPerCall(moves.size(), [&] {
+        for (size_t i = 0; i < moves.size(); ++i) {
+            const auto& m = moves[i];
+            indexed_result[i] = indexed.ClampPosition(m.old_x, m.old_y, m.new_x, m.new_y);
+        }
+    });
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < moves.size(); ++i) {
+        mismatches += linear_result[i] != indexed_result[i];
+    }
+
+    std::cout << "roads: " << indexed.GetRoads().size()
+        << ", buildings: " << indexed.GetBuildings().size()
+        << ", queries: " << moves.size() << '\n'
+        << "linear scan: " << linear_ns << " ns/query\n"
+        << "spatial index: " << indexed_ns << " ns/query\n"
+        << "speedup: " << linear_ns / indexed_ns << "x\n"
+        << "mismatches: " << mismatches << std::endl;
+    return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
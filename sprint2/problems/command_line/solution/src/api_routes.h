@@ -0,0 +1,133 @@
+#pragma once
+#include <boost/beast/http/verb.hpp>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace http_handler {
+
+    enum class ApiEndpoint : uint8_t {
+        JOIN,
+        PLAYERS,
+        STATE,
+        STATE_WAIT,
+        PLAYER_ACTION,
+        TICK,
+        LATENCY,
+    };
+
+    inline constexpr size_t API_ENDPOINT_COUNT = 7;
+
+    // Набор разрешённых методов маршрута в виде битовой маски
+    enum ApiMethod : uint8_t {
+        API_GET = 1 << 0,
+        API_HEAD = 1 << 1,
+        API_POST = 1 << 2,
+    };
+
+    struct ApiRoute {
+        std::string_view path;
+        ApiEndpoint endpoint;
+        uint8_t methods;
+
+        constexpr bool Allows(boost::beast::http::verb method) const noexcept {
+            using boost::beast::http::verb;
+            switch (method) {
+            case verb::get:
+                return methods & API_GET;
+            case verb::head:
+                return methods & API_HEAD;
+            case verb::post:
+                return methods & API_POST;
+            default:
+                return false;
+            }
+        }
+
+        // Значение заголовка Allow для ответа 405
+        constexpr std::string_view Allow() const noexcept {
+            constexpr std::array<std::string_view, 8> ALLOW = {
+                "", "GET", "HEAD", "GET, HEAD", "POST", "GET, POST", "HEAD, POST", "GET, HEAD, POST"
+            };
+            return ALLOW[methods & 7];
+        }
+    };
+
+    namespace detail {
+
+        inline constexpr std::array<ApiRoute, API_ENDPOINT_COUNT> API_ROUTES = { {
+            { "/api/v1/game/join", ApiEndpoint::JOIN, API_POST },
+            { "/api/v1/game/players", ApiEndpoint::PLAYERS, API_GET | API_HEAD },
+            { "/api/v1/game/state", ApiEndpoint::STATE, API_GET | API_HEAD },
+            { "/api/v1/game/state/wait", ApiEndpoint::STATE_WAIT, API_GET | API_HEAD },
+            { "/api/v1/game/player/action", ApiEndpoint::PLAYER_ACTION, API_POST },
+            { "/api/v1/game/tick", ApiEndpoint::TICK, API_POST },
+            { "/api/v1/admin/latency", ApiEndpoint::LATENCY, API_GET | API_HEAD },
+        } };
+
+        // Маршрут с индексом i описывает ApiEndpoint со значением i
+        constexpr bool IsApiRouteOrderValid() noexcept {
+            for (size_t i = 0; i < API_ROUTES.size(); ++i) {
+                if (static_cast<size_t>(API_ROUTES[i].endpoint) != i) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        static_assert(IsApiRouteOrderValid(), "API_ROUTES must be listed in ApiEndpoint order");
+
+        inline constexpr size_t API_ROUTE_TABLE_SIZE = 32;
+        using ApiRouteTable = std::array<ApiRoute, API_ROUTE_TABLE_SIZE>;
+
+        // FNV-1a
+        constexpr size_t HashApiPath(std::string_view path) noexcept {
+            uint32_t hash = 2166136261u;
+            for (const char c : path) {
+                hash ^= static_cast<uint8_t>(c);
+                hash *= 16777619u;
+            }
+            return hash % API_ROUTE_TABLE_SIZE;
+        }
+
+        constexpr bool IsPerfectApiHash() noexcept {
+            std::array<bool, API_ROUTE_TABLE_SIZE> used{};
+            for (const auto& route : API_ROUTES) {
+                auto& slot = used[HashApiPath(route.path)];
+                if (slot) {
+                    return false;
+                }
+                slot = true;
+            }
+            return true;
+        }
+
+        constexpr ApiRouteTable BuildApiRouteTable() noexcept {
+            ApiRouteTable table{};
+            for (const auto& route : API_ROUTES) {
+                table[HashApiPath(route.path)] = route;
+            }
+            return table;
+        }
+
+        static_assert(IsPerfectApiHash(), "API route hashes collide: change API_ROUTE_TABLE_SIZE");
+
+        inline constexpr ApiRouteTable API_ROUTE_TABLE = BuildApiRouteTable();
+
+    }  // namespace detail
+
+    // Таблица маршрутов API с идеальным хешем, проверяемым при компиляции:
+    // поиск пути — одно хеширование и одно сравнение строк
+    constexpr std::optional<ApiRoute> FindApiRoute(std::string_view path) noexcept {
+        const auto& route = detail::API_ROUTE_TABLE[detail::HashApiPath(path)];
+        if (route.path.empty() || route.path != path) {
+            return std::nullopt;
+        }
+        return route;
+    }
+
+    static_assert(FindApiRoute("/api/v1/game/state/wait")->endpoint == ApiEndpoint::STATE_WAIT);
+    static_assert(!FindApiRoute("/api/v1/game/unknown"));
+
+} // namespace http_handler
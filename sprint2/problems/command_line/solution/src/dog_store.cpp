@@ -0,0 +1,119 @@
+#include "dog_store.h"
+#include <cmath>
+
+namespace model {
+
+    DogStore::DogStore(size_t map_index) noexcept
+        : map_index_(map_index) {}
+
+    size_t DogStore::GetMapIndex() const noexcept {
+        return map_index_;
+    }
+
+    size_t DogStore::Size() const noexcept {
+        return x_.size();
+    }
+
+    uint64_t DogStore::GetVersion() const noexcept {
+        return version_;
+    }
+
+    uint64_t DogStore::GetRosterVersion() const noexcept {
+        return roster_version_;
+    }
+
+    DogStore::Slot DogStore::Add(double x, double y) {
+        const auto slot = static_cast<Slot>(x_.size());
+        x_.push_back(x);
+        y_.push_back(y);
+        vx_.push_back(0.0);
+        vy_.push_back(0.0);
+        direction_.push_back(Direction::NORTH);
+        changed_at_.push_back(++version_);
+        ++roster_version_;
+        return slot;
+    }
+
+    std::array<double, 2> DogStore::GetPosition(Slot slot) const noexcept {
+        return { x_[slot], y_[slot] };
+    }
+
+    std::array<double, 2> DogStore::GetSpeed(Slot slot) const noexcept {
+        return { vx_[slot], vy_[slot] };
+    }
+
+    Direction DogStore::GetDirection(Slot slot) const noexcept {
+        return direction_[slot];
+    }
+
+    uint64_t DogStore::GetChangedAt(Slot slot) const noexcept {
+        return changed_at_[slot];
+    }
+
+    void DogStore::SetPosition(Slot slot, double x, double y) noexcept {
+        x_[slot] = x;
+        y_[slot] = y;
+        changed_at_[slot] = ++version_;
+    }
+
+    void DogStore::SetSpeed(Slot slot, double vx, double vy) noexcept {
+        vx_[slot] = vx;
+        vy_[slot] = vy;
+        changed_at_[slot] = ++version_;
+        if (vx == 0 && vy == 0) {
+            return;
+        }
+        if (std::abs(vx) > std::abs(vy)) {
+            direction_[slot] = vx > 0 ? Direction::EAST : Direction::WEST;
+        }
+        else {
+            direction_[slot] = vy > 0 ? Direction::SOUTH : Direction::NORTH;
+        }
+    }
+
+    void DogStore::SetDirection(Slot slot, Direction dir) noexcept {
+        direction_[slot] = dir;
+        changed_at_[slot] = ++version_;
+    }
+
+    void DogStore::Integrate(double delta_time, const Map& map) {
+        const size_t count = x_.size();
+        next_x_.resize(count);
+        next_y_.resize(count);
+
+        double* __restrict x = x_.data();
+        double* __restrict y = y_.data();
+        double* __restrict vx = vx_.data();
+        double* __restrict vy = vy_.data();
+        double* __restrict next_x = next_x_.data();
+        double* __restrict next_y = next_y_.data();
+
+        // Интегрирование без ветвлений: этот цикл векторизуется
+        for (size_t i = 0; i < count; ++i) {
+            next_x[i] = x[i] + vx[i] * delta_time / 1000.0;
+            next_y[i] = y[i] + vy[i] * delta_time / 1000.0;
+        }
+
+        // Ограничение дорогами нужно только движущимся собакам
+        const uint64_t next_version = version_ + 1;
+        bool changed = false;
+        for (size_t i = 0; i < count; ++i) {
+            if (vx[i] == 0 && vy[i] == 0) {
+                continue;
+            }
+            changed = true;
+            changed_at_[i] = next_version;
+            auto [clamped_x, clamped_y] = map.ClampPosition(x[i], y[i], next_x[i], next_y[i]);
+            if (clamped_x != next_x[i] || clamped_y != next_y[i]) {
+                vx[i] = 0.0;
+                vy[i] = 0.0;
+            }
+            x[i] = clamped_x;
+            y[i] = clamped_y;
+        }
+        if (changed) {
+            version_ = next_version;
+        }
+    }
+
+} // namespace model
@@ -0,0 +1,63 @@
+#pragma once
+#include "map.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace model {
+
+    enum class Direction {
+        NORTH = 'U',
+        SOUTH = 'D',
+        WEST = 'L',
+        EAST = 'R'
+    };
+
+    // Состояние всех собак одной карты в виде структуры массивов (SoA):
+    // координаты и скорости лежат в отдельных непрерывных массивах, что позволяет
+    // компилятору векторизовать шаг интегрирования в Integrate.
+    class DogStore {
+    public:
+        using Slot = uint32_t;
+
+        explicit DogStore(size_t map_index) noexcept;
+
+        size_t GetMapIndex() const noexcept;
+        size_t Size() const noexcept;
+        // Растёт при каждом изменении состояния собак карты: по нему кэшируются ответы API
+        uint64_t GetVersion() const noexcept;
+        // Растёт только при изменении состава собак на карте
+        uint64_t GetRosterVersion() const noexcept;
+
+        Slot Add(double x, double y);
+
+        std::array<double, 2> GetPosition(Slot slot) const noexcept;
+        std::array<double, 2> GetSpeed(Slot slot) const noexcept;
+        Direction GetDirection(Slot slot) const noexcept;
+        // Версия, на которой состояние собаки менялось последний раз (журнал изменений карты)
+        uint64_t GetChangedAt(Slot slot) const noexcept;
+
+        void SetPosition(Slot slot, double x, double y) noexcept;
+        void SetSpeed(Slot slot, double vx, double vy) noexcept;
+        void SetDirection(Slot slot, Direction dir) noexcept;
+
+        // Перемещает всех собак на delta_time миллисекунд и ограничивает их дорогами карты
+        void Integrate(double delta_time, const Map& map);
+
+    private:
+        size_t map_index_;
+        uint64_t version_ = 0;
+        uint64_t roster_version_ = 0;
+        std::vector<double> x_;
+        std::vector<double> y_;
+        std::vector<double> vx_;
+        std::vector<double> vy_;
+        std::vector<Direction> direction_;
+        std::vector<uint64_t> changed_at_;
+
+        // Буферы для новых координат, переиспользуются между тиками
+        std::vector<double> next_x_;
+        std::vector<double> next_y_;
+    };
+
+} // namespace model
@@ -29,6 +29,13 @@ namespace model {
         return nullptr;
     }
 
+    std::optional<size_t> Game::FindMapIndex(const Map::Id& id) const noexcept {
+        if (auto it = map_id_to_index_.find(id); it != map_id_to_index_.end()) {
+            return it->second;
+        }
+        return std::nullopt;
+    }
+
     void Game::AddMap(Map map) {
         const size_t index = maps_.size();
         if (auto [it, inserted] = map_id_to_index_.emplace(map.GetId(), index); !inserted) {
@@ -37,8 +44,16 @@ namespace model {
         else {
             try {
                 maps_.emplace_back(std::move(map));
+                dog_stores_.emplace_back(index);
+                map_players_.emplace_back();
             }
             catch (...) {
+                if (maps_.size() > index) {
+                    maps_.pop_back();
+                }
+                if (dog_stores_.size() > index) {
+                    dog_stores_.pop_back();
+                }
                 map_id_to_index_.erase(it);
                 throw;
             }
@@ -53,8 +68,11 @@ namespace model {
         return randomize_spawn_points_;
     }
 
-    std::shared_ptr<Player> Game::JoinGame(const std::string& player_name, const Map::Id& map_id) {
+    std::optional<Player> Game::JoinGame(const std::string& player_name, const Map::Id& map_id) {
         if (const auto* map = FindMap(map_id)) {
+            // Токен генерируется до захвата блокировки: генератор потокобезопасен
+            auto token = token_generator_.GenerateToken();
+            std::unique_lock lock{ players_mutex_ };
             Point spawn_point;
 
             if (randomize_spawn_points_) {
@@ -84,27 +102,48 @@ namespace model {
                 spawn_point = map->GetSpawnPoint();
             }
 
-            auto dog = std::make_shared<Dog>(Dog::Id{ "" }, player_name, spawn_point);
-            dog->SetMap(map);
-            auto player = players_.Add(player_name, dog);
-            player->SetToken(token_generator_.GenerateToken());
+            const size_t map_index = map - maps_.data();
+            auto& map_players = map_players_[map_index];
+            // Место под игрока выделяется до его создания, чтобы push_back ниже не бросал.
+            // Ёмкость растёт вдвое: резерв ровно на один элемент копировал бы список на каждом входе
+            if (map_players.size() == map_players.capacity()) {
+                map_players.reserve(std::max<size_t>(2 * map_players.capacity(), 8));
+            }
+
+            auto& store = dog_stores_[map_index];
+            const auto slot = store.Add(spawn_point.x, spawn_point.y);
+            const auto& player = players_.Add(player_name, Dog{ map, store, slot }, token);
+            map_players.push_back(player.GetId());
             return player;
         }
-        return nullptr;
+        return std::nullopt;
     }
 
-    const std::vector<std::shared_ptr<Player>>& Game::GetPlayers() const {
-        return players_.GetPlayers();
-    }
-
-    std::shared_ptr<Player> Game::FindPlayerByToken(const Token& token) {
-        return players_.FindByToken(token);
+    std::optional<Dog> Game::FindDogByToken(const Token& token) const {
+        std::shared_lock lock{ players_mutex_ };
+        if (const auto* player = players_.FindByToken(token)) {
+            return player->GetDog();
+        }
+        return std::nullopt;
     }
 
     void Game::UpdateState(int delta_time) {
-        for (const auto& player : players_.GetPlayers()) {
-            player->GetDog().UpdatePosition(delta_time);
+        for (size_t i = 0; i < maps_.size(); ++i) {
+            UpdateMapState(i, delta_time);
         }
     }
 
+    void Game::UpdateMapState(size_t map_index, int delta_time) {
+        dog_stores_.at(map_index).Integrate(delta_time, maps_[map_index]);
+    }
+
+    const DogStore& Game::GetDogStore(size_t map_index) const {
+        return dog_stores_.at(map_index);
+    }
+
+    size_t Game::GetPlayerCount(size_t map_index) const {
+        std::shared_lock lock{ players_mutex_ };
+        return map_players_.at(map_index).size();
+    }
+
 } // namespace model
\ No newline at end of file
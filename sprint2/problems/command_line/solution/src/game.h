@@ -1,9 +1,15 @@
 #pragma once
 #include "map.h"
+#include "dog_store.h"
 #include "player.h"
 #include "token_generator.h"
+#include <deque>
 #include <vector>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <shared_mutex>
 #include <unordered_map>
 
 namespace model {
@@ -25,15 +31,35 @@ namespace model {
         double GetDefaultDogSpeed() const noexcept;
         const Maps& GetMaps() const noexcept;
         const Map* FindMap(const Map::Id& id) const noexcept;
+        std::optional<size_t> FindMapIndex(const Map::Id& id) const noexcept;
 
         void AddMap(Map map);
         void SetRandomSpawnPoints(bool randomize) noexcept;
         bool IsRandomSpawnPoints() const noexcept;
 
-        std::shared_ptr<Player> JoinGame(const std::string& player_name, const Map::Id& map_id);
-        const std::vector<std::shared_ptr<Player>>& GetPlayers() const;
-        std::shared_ptr<Player> FindPlayerByToken(const Token& token);
+        //         players_mutex_.
+        // JoinGame  DogStore ,    strand'  
+        //    :       
+        std::optional<Player> JoinGame(const std::string& player_name, const Map::Id& map_id);
+        // Dog   ,       
+        std::optional<Dog> FindDogByToken(const Token& token) const;
+
+        //           DogStore 
+        template <typename Fn>
+        void ForEachPlayerOnMap(size_t map_index, Fn&& fn) const {
+            std::shared_lock lock{ players_mutex_ };
+            for (const auto id : map_players_.at(map_index)) {
+                fn(*players_.Find(id));
+            }
+        }
+
+        size_t GetPlayerCount(size_t map_index) const;
+
         void UpdateState(int delta_time);
+        //    .     ,
+        //     map_index   
+        void UpdateMapState(size_t map_index, int delta_time);
+        const DogStore& GetDogStore(size_t map_index) const;
 
     private:
         using MapIdHasher = util::TaggedHasher<Map::Id>;
@@ -42,7 +68,13 @@ namespace model {
         double default_dog_speed_;
         std::vector<Map> maps_;
         MapIdToIndex map_id_to_index_;
+        //   ,      maps_.
+        // deque     ,    Dog  
+        std::deque<DogStore> dog_stores_;
         Players players_;
+        //   ,      maps_,       
+        std::vector<std::vector<Player::Id>> map_players_;
+        mutable std::shared_mutex players_mutex_;
         TokenGenerator token_generator_;
         bool randomize_spawn_points_;
         std::random_device random_device_;
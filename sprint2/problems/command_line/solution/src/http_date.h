@@ -0,0 +1,81 @@
+#pragma once
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace util {
+
+    // Дата в формате IMF-fixdate из RFC 7231, например "Sun, 06 Nov 1994 08:49:37 GMT"
+    inline std::string FormatHttpDate(std::chrono::sys_seconds time) {
+        using namespace std::chrono;
+        constexpr std::array<std::string_view, 7> WEEKDAYS = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+        constexpr std::array<std::string_view, 12> MONTHS = {
+            "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+        };
+
+        const auto days = floor<std::chrono::days>(time);
+        const year_month_day date{ days };
+        const hh_mm_ss clock{ time - days };
+
+        const auto two_digits = [](std::string& out, unsigned value) {
+            out += static_cast<char>('0' + value / 10);
+            out += static_cast<char>('0' + value % 10);
+        };
+
+        std::string result;
+        result.reserve(29);
+        result += WEEKDAYS[weekday{ days }.c_encoding()];
+        result += ", ";
+        two_digits(result, static_cast<unsigned>(date.day()));
+        result += ' ';
+        result += MONTHS[static_cast<unsigned>(date.month()) - 1];
+        result += ' ';
+        result += std::to_string(static_cast<int>(date.year()));
+        result += ' ';
+        two_digits(result, static_cast<unsigned>(clock.hours().count()));
+        result += ':';
+        two_digits(result, static_cast<unsigned>(clock.minutes().count()));
+        result += ':';
+        two_digits(result, static_cast<unsigned>(clock.seconds().count()));
+        result += " GMT";
+        return result;
+    }
+
+    // Разбирает только IMF-fixdate: устаревшие форматы RFC 850 и asctime клиенты уже не присылают
+    inline std::optional<std::chrono::sys_seconds> ParseHttpDate(std::string_view text) {
+        using namespace std::chrono;
+        constexpr std::string_view MONTHS = "JanFebMarAprMayJunJulAugSepOctNovDec";
+
+        // "Sun, 06 Nov 1994 08:49:37 GMT"
+        if (text.size() != 29 || text.substr(3, 2) != ", " || text.substr(25) != " GMT") {
+            return std::nullopt;
+        }
+
+        const auto number = [text](size_t pos, size_t len, int& value) {
+            const auto part = text.substr(pos, len);
+            auto [ptr, ec] = std::from_chars(part.data(), part.data() + part.size(), value);
+            return ec == std::errc{} && ptr == part.data() + part.size();
+        };
+
+        int day = 0, year = 0, hours = 0, minutes = 0, seconds = 0;
+        const auto month_pos = MONTHS.find(text.substr(8, 3));
+        if (month_pos == std::string_view::npos || month_pos % 3 != 0
+            || !number(5, 2, day) || !number(12, 4, year)
+            || !number(17, 2, hours) || !number(20, 2, minutes) || !number(23, 2, seconds)
+            || text[7] != ' ' || text[11] != ' ' || text[16] != ' ' || text[19] != ':' || text[22] != ':') {
+            return std::nullopt;
+        }
+
+        const year_month_day date{ std::chrono::year{ year },
+            month{ static_cast<unsigned>(month_pos / 3 + 1) }, std::chrono::day{ static_cast<unsigned>(day) } };
+        if (!date.ok() || hours > 23 || minutes > 59 || seconds > 60) {
+            return std::nullopt;
+        }
+        return sys_days{ date } + std::chrono::hours{ hours } + std::chrono::minutes{ minutes }
+            + std::chrono::seconds{ seconds };
+    }
+
+} // namespace util
@@ -0,0 +1,169 @@
+#pragma once
+#include <boost/asio/buffer.hpp>
+#include <boost/beast/core/file.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/optional.hpp>
+#include "recycling_allocator.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <utility>
+#include <variant>
+
+namespace http_server {
+
+    namespace net = boost::asio;
+    namespace beast = boost::beast;
+    namespace http = beast::http;
+
+    // Тело ответа, ссылающееся на неизменяемый буфер в памяти (например, файл из кэша статики).
+    // owner продлевает жизнь буфера до окончания записи, данные не копируются
+    struct SharedBufferBody {
+        struct value_type {
+            std::shared_ptr<const void> owner;
+            std::string_view data;
+        };
+
+        static std::uint64_t size(const value_type& body) noexcept {
+            return body.data.size();
+        }
+
+        class writer {
+        public:
+            using const_buffers_type = net::const_buffer;
+
+            template <bool isRequest, typename Fields>
+            writer(const http::header<isRequest, Fields>&, const value_type& body) noexcept
+                : body_(body) {
+            }
+
+            void init(beast::error_code& ec) noexcept {
+                ec = {};
+            }
+
+            boost::optional<std::pair<const_buffers_type, bool>> get(beast::error_code& ec) noexcept {
+                ec = {};
+                return { { net::const_buffer(body_.data.data(), body_.data.size()), false } };
+            }
+
+        private:
+            const value_type& body_;
+        };
+    };
+
+    // Тело ответа — диапазон байт файла на диске. На Linux Session отправляет его через sendfile,
+    // writer используется как запасной путь и читает файл блоками
+    struct FileRangeBody {
+        struct value_type {
+            beast::file file;
+            std::uint64_t offset = 0;
+            std::uint64_t length = 0;
+        };
+
+        static std::uint64_t size(const value_type& body) noexcept {
+            return body.length;
+        }
+
+        class writer {
+        public:
+            using const_buffers_type = net::const_buffer;
+
+            template <bool isRequest, typename Fields>
+            writer(const http::header<isRequest, Fields>&, value_type& body) noexcept
+                : body_(body) {
+            }
+
+            void init(beast::error_code& ec) {
+                body_.file.seek(body_.offset, ec);
+                remain_ = body_.length;
+            }
+
+            boost::optional<std::pair<const_buffers_type, bool>> get(beast::error_code& ec) {
+                const auto amount = static_cast<size_t>(std::min<std::uint64_t>(remain_, sizeof(buffer_)));
+                if (amount == 0) {
+                    ec = {};
+                    return boost::none;
+                }
+                const auto read = body_.file.read(buffer_, amount, ec);
+                if (ec) {
+                    return boost::none;
+                }
+                if (read == 0) {
+                    // Файл стал короче, чем было объявлено в Content-Length
+                    ec = http::error::short_read;
+                    return boost::none;
+                }
+                remain_ -= read;
+                return { { net::const_buffer(buffer_, read), remain_ > 0 } };
+            }
+
+        private:
+            value_type& body_;
+            std::uint64_t remain_ = 0;
+            char buffer_[64 * 1024];
+        };
+    };
+
+    // Заголовки и строковые тела запросов и ответов берут память из кэша потока
+    using Fields = http::basic_fields<util::RecyclingAllocator<char>>;
+    using StringBody = http::basic_string_body<char, std::char_traits<char>, util::RecyclingAllocator<char>>;
+
+    using StringRequest = http::request<StringBody, Fields>;
+    using StringResponse = http::response<StringBody, Fields>;
+    using BufferResponse = http::response<SharedBufferBody, Fields>;
+    using FileResponse = http::response<FileRangeBody, Fields>;
+    // Любой ответ, который умеет отправлять Session
+    using Response = std::variant<StringResponse, BufferResponse, FileResponse>;
+
+    // Время обработки одного запроса по фазам
+    struct RequestTimings {
+        using Duration = std::chrono::steady_clock::duration;
+        static constexpr unsigned UNKNOWN_ROUTE = ~0u;
+
+        // Метка маршрута, которую ставит обработчик через ResponseSender::SetRoute
+        unsigned route = UNKNOWN_ROUTE;
+        unsigned status = 0;
+        // От первых полученных байт запроса до его полного разбора
+        Duration read{};
+        // Ожидание в очереди strand'а карты
+        Duration queue{};
+        // От разбора запроса до готового ответа, без queue
+        Duration handle{};
+        // От готового ответа до его отправки, включая ожидание предыдущих ответов соединения
+        Duration write{};
+    };
+
+    // Вызывается на потоке сессии после отправки каждого ответа
+    using RequestObserver = std::function<void(const RequestTimings&)>;
+
+    class Session;
+
+    // Передаёт ответ обратно в сессию. Держит сессию живой, пока ответ не отправлен.
+    // Копируется без выделения памяти, в отличие от std::function с захваченным shared_ptr.
+    // sequence — номер запроса в соединении: ответы уходят клиенту в порядке запросов
+    class ResponseSender {
+    public:
+        ResponseSender(std::shared_ptr<Session> session, std::uint64_t sequence) noexcept
+            : session_(std::move(session))
+            , sequence_(sequence) {
+        }
+
+        void operator()(Response&& response) const;
+
+        // Вызывается обработчиком до отправки ответа
+        void SetRoute(unsigned route) const noexcept;
+        void SetQueueTime(RequestTimings::Duration queue) const noexcept;
+        // Соединение оборвано, ответ уже никто не получит. Можно вызывать с любого потока
+        bool IsAborted() const noexcept;
+        // Запрос пришёл с этой же машины
+        bool IsLoopback() const noexcept;
+
+    private:
+        std::shared_ptr<Session> session_;
+        std::uint64_t sequence_;
+    };
+
+}  // namespace http_server
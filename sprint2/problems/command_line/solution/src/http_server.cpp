@@ -1,55 +1,390 @@
 #include "http_server.h"
-#include <iostream>
+#include "logger.h"
+#include <span>
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#include <cerrno>
+#endif
 
 namespace http_server {
 
     void Session::Run() {
-        net::dispatch(stream_.get_executor(),
-            beast::bind_front_handler(&Session::Read, shared_from_this()));
+        net::dispatch(stream_.get_executor(), [self = shared_from_this()] {
+            beast::error_code ec;
+            const auto remote_address = self->stream_.socket().remote_endpoint(ec).address();
+            self->remote_ip_ = remote_address.to_string();
+            self->loopback_ = !ec && remote_address.is_loopback();
+            self->write_buffers_.reserve(MAX_PIPELINED_REQUESTS * 8);
+            self->idle_timer_.expires_after(IDLE_TIMEOUT);
+            self->WaitIdle();
+            self->Read();
+        });
     }
 
+    //  ,      .    idle_timer_,
+    //  ,   ,      
     void Session::Read() {
-        request_ = {};
-        stream_.expires_after(std::chrono::seconds(30));
-        http::async_read(stream_, buffer_, request_,
-            beast::bind_front_handler(&Session::OnRead, shared_from_this()));
+        if (reading_ || read_done_ || next_request_ - next_response_ >= MAX_PIPELINED_REQUESTS) {
+            return;
+        }
+        reading_ = true;
+        parser_.emplace();
+        read_started_.reset();
+        stream_.expires_never();
+        ReadSome();
+    }
+
+    //    ,  ,     
+    void Session::ReadSome() {
+        http::async_read_some(stream_, buffer_, *parser_,
+            beast::bind_front_handler(&Session::OnReadSome, shared_from_this()));
+    }
+
+    void Session::OnReadSome(beast::error_code ec, std::size_t) {
+        if (ec || aborted_) {
+            return OnRead(ec);
+        }
+        if (!read_started_) {
+            read_started_ = std::chrono::steady_clock::now();
+        }
+        if (!parser_->is_done()) {
+            return ReadSome();
+        }
+        request_ = parser_->release();
+        OnRead({});
     }
 
-    void Session::OnRead(beast::error_code ec, std::size_t bytes_read) {
-        if (ec == http::error::end_of_stream) {
+    void Session::OnRead(beast::error_code ec) {
+        reading_ = false;
+        if (aborted_) {
+            return;
+        }
+        if (ec) {
+            read_done_ = true;
+            //  ,   :   ( ) 
+            //    ResponseSender::IsAborted       
+            if (ec != http::error::end_of_stream || HasPendingResponses()) {
+                return Abort(ec, "read");
+            }
             return Close();
         }
+
+        last_activity_ = std::chrono::steady_clock::now();
+        if (!request_.keep_alive()) {
+            read_done_ = true;
+        }
+        GetServerStats().requests.Add(1);
+        const auto sequence = next_request_++;
+        auto& pending = pending_[sequence % MAX_PIPELINED_REQUESTS];
+        pending.timings = {};
+        pending.timings.read = last_activity_ - read_started_.value_or(last_activity_);
+        pending.received = last_activity_;
+
+        const auto target = request_.target();
+        const auto method = request_.method_string();
+        logger::Logger::GetInstance().Log("request received", {
+            { "ip", remote_ip_ },
+            { "URI", std::string_view{ target.data(), target.size() } },
+            { "method", std::string_view{ method.data(), method.size() } } });
+
+        request_handler_(std::move(request_), ResponseSender{ shared_from_this(), sequence });
+        Read();
+    }
+
+    //       strand' (),     executor 
+    void ResponseSender::operator()(Response&& response) const {
+        net::dispatch(session_->stream_.get_executor(),
+            [session = session_, sequence = sequence_, response = std::move(response)]() mutable {
+                session->OnResponse(sequence, std::move(response));
+            });
+    }
+
+    //         ,   
+    //  executor        OnResponse
+    void ResponseSender::SetRoute(unsigned route) const noexcept {
+        session_->pending_[sequence_ % Session::MAX_PIPELINED_REQUESTS].timings.route = route;
+    }
+
+    void ResponseSender::SetQueueTime(RequestTimings::Duration queue) const noexcept {
+        session_->pending_[sequence_ % Session::MAX_PIPELINED_REQUESTS].timings.queue = queue;
+    }
+
+    bool ResponseSender::IsAborted() const noexcept {
+        return session_->aborted_.load(std::memory_order_relaxed);
+    }
+
+    bool ResponseSender::IsLoopback() const noexcept {
+        return session_->loopback_;
+    }
+
+    void Session::OnResponse(std::uint64_t sequence, Response&& response) {
+        if (aborted_) {
+            return;
+        }
+        auto& pending = pending_[sequence % MAX_PIPELINED_REQUESTS];
+        pending.ready = std::chrono::steady_clock::now();
+        pending.timings.handle = pending.ready - pending.received - pending.timings.queue;
+        pending.timings.status = std::visit([](const auto& typed) { return typed.result_int(); }, response);
+        pending.response.emplace(std::move(response));
+        WriteNext();
+    }
+
+    void Session::OnSent(Pending& pending, std::chrono::steady_clock::time_point now) {
+        using std::chrono::duration;
+        using Milliseconds = duration<double, std::milli>;
+        auto& timings = pending.timings;
+        timings.write = now - pending.ready;
+
+        std::visit([&timings](const auto& typed) {
+            const auto content_type = typed[http::field::content_type];
+            logger::Logger::GetInstance().Log("response sent", {
+                { "response_time", Milliseconds(timings.queue + timings.handle).count() },
+                { "code", timings.status },
+                { "content_type", std::string_view{ content_type.data(), content_type.size() } },
+                { "read_time", Milliseconds(timings.read).count() },
+                { "queue_time", Milliseconds(timings.queue).count() },
+                { "write_time", Milliseconds(timings.write).count() } });
+        }, *pending.response);
+
+        if (observer_) {
+            observer_(timings);
+        }
+    }
+
+    void Session::WriteNext() {
+        if (writing_ || aborted_ || next_response_ == next_request_) {
+            return;
+        }
+        const auto& head = pending_[next_response_ % MAX_PIPELINED_REQUESTS].response;
+        if (!head) {
+            //        
+            return;
+        }
+        writing_ = true;
+        stream_.expires_after(WRITE_TIMEOUT);
+        if (std::holds_alternative<FileResponse>(*head)) {
+            return WriteFile();
+        }
+        WriteBatch();
+    }
+
+    void Session::WriteBatch() {
+        write_buffers_.clear();
+        std::size_t count = 0;
+        bool close = false;
+        beast::error_code ec;
+        for (auto sequence = next_response_; sequence != next_request_ && !close && !ec; ++sequence, ++count) {
+            auto& pending = pending_[sequence % MAX_PIPELINED_REQUESTS];
+            auto& response = pending.response;
+            if (!response || std::holds_alternative<FileResponse>(*response)) {
+                break;
+            }
+            std::visit([&](auto& typed) {
+                using Body = typename std::decay_t<decltype(typed)>::body_type;
+                if constexpr (!std::is_same_v<Body, FileRangeBody>) {
+                    using Serializer = http::response_serializer<Body, Fields>;
+                    auto& serializer = std::get<Serializer>(
+                        pending.serializer.emplace(std::in_place_type<Serializer>, typed));
+                    //      ,   next()   .
+                    //   ,   
+                    serializer.next(ec, [this](beast::error_code&, const auto& buffers) {
+                        for (const auto buffer : beast::buffers_range_ref(buffers)) {
+                            write_buffers_.emplace_back(buffer);
+                        }
+                    });
+                    close = typed.need_eof();
+                }
+            }, *response);
+        }
         if (ec) {
-            return ReportError(ec, "read");
+            return Abort(ec, "write");
         }
 
-        request_handler_(std::move(request_), [self = shared_from_this()](auto&& response) {
-            auto safe_response = std::make_shared<http::response<http::string_body>>(
-                std::forward<decltype(response)>(response));
-            http::async_write(self->stream_, *safe_response,
-                [self, safe_response](beast::error_code ec, std::size_t bytes_written) {
-                    self->OnWrite(safe_response->need_eof(), ec, bytes_written);
-                });
+        net::async_write(stream_, std::span<const net::const_buffer>(write_buffers_),
+            [self = shared_from_this(), count, close](beast::error_code ec, std::size_t bytes_written) {
+                self->OnWrite(count, close, ec, bytes_written);
             });
     }
 
-    void Session::OnWrite(bool close, beast::error_code ec, std::size_t bytes_written) {
+    void Session::WriteFile() {
+        auto& response = std::get<FileResponse>(*pending_[next_response_ % MAX_PIPELINED_REQUESTS].response);
+        file_serializer_.emplace(response);
+        file_progress_ = std::chrono::steady_clock::now();
+#ifdef __linux__
+        //   Beast,        sendfile     
+        http::async_write_header(stream_, *file_serializer_,
+            [self = shared_from_this(), &body = response.body()](beast::error_code ec, std::size_t bytes_written) {
+                if (ec) {
+                    return self->Abort(ec, "write");
+                }
+                GetServerStats().bytes_sent.Add(bytes_written);
+                self->SendFileBody(body.offset, body.length);
+            });
+#else
+        http::async_write(stream_, *file_serializer_,
+            [self = shared_from_this(), close = response.need_eof()](beast::error_code ec, std::size_t bytes_written) {
+                self->OnWrite(1, close, ec, bytes_written);
+            });
+#endif
+    }
+
+    void Session::SendFileBody(std::uint64_t offset, std::uint64_t remain) {
+#ifdef __linux__
+        constexpr std::uint64_t MAX_CHUNK = 1 << 20;
+        auto& response = std::get<FileResponse>(*pending_[next_response_ % MAX_PIPELINED_REQUESTS].response);
+        auto& socket = stream_.socket();
+        beast::error_code ec;
+        socket.native_non_blocking(true, ec);
         if (ec) {
-            return ReportError(ec, "write");
+            return Abort(ec, "sendfile");
         }
+
+        while (remain > 0) {
+            off_t file_offset = static_cast<off_t>(offset);
+            const auto sent = ::sendfile(socket.native_handle(), response.body().file.native_handle(),
+                &file_offset, static_cast<size_t>(std::min(remain, MAX_CHUNK)));
+            if (sent > 0) {
+                file_progress_ = std::chrono::steady_clock::now();
+                GetServerStats().bytes_sent.Add(static_cast<std::uint64_t>(sent));
+                offset += static_cast<std::uint64_t>(sent);
+                remain -= static_cast<std::uint64_t>(sent);
+                continue;
+            }
+            if (sent < 0 && errno == EINTR) {
+                continue;
+            }
+            if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                //   : ,      
+                return socket.async_wait(tcp::socket::wait_write,
+                    [self = shared_from_this(), offset, remain](beast::error_code ec) {
+                        if (ec) {
+                            return self->Abort(ec, "sendfile");
+                        }
+                        self->SendFileBody(offset, remain);
+                    });
+            }
+            // sent == 0:   ,    Content-Length
+            return Abort(sent == 0 ? beast::error_code{ http::error::short_read }
+                : beast::error_code{ errno, boost::system::system_category() }, "sendfile");
+        }
+        OnWrite(1, response.need_eof(), {}, 0);
+#endif
+    }
+
+    void Session::OnWrite(std::size_t count, bool close, beast::error_code ec, std::size_t bytes_written) {
+        writing_ = false;
+        GetServerStats().bytes_sent.Add(bytes_written);
+        if (ec) {
+            return Abort(ec, "write");
+        }
+
+        //    (  ) ,    
+        file_serializer_.reset();
+        last_activity_ = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < count; ++i, ++next_response_) {
+            auto& pending = pending_[next_response_ % MAX_PIPELINED_REQUESTS];
+            OnSent(pending, last_activity_);
+            pending.serializer.reset();
+            pending.response.reset();
+        }
+
         if (close) {
+            read_done_ = true;
+            return Close();
+        }
+        if (read_done_ && !HasPendingResponses()) {
             return Close();
         }
         Read();
+        WriteNext();
+    }
+
+    //       :      ,
+    //        
+    void Session::WaitIdle() {
+        idle_timer_.async_wait(beast::bind_front_handler(&Session::OnIdleTimer, shared_from_this()));
+    }
+
+    void Session::OnIdleTimer(beast::error_code ec) {
+        if (ec || aborted_) {
+            return;
+        }
+        const bool busy = HasPendingResponses();
+        if (!busy && (read_done_ || !reading_)) {
+            //   ,  
+            return;
+        }
+        const auto now = std::chrono::steady_clock::now();
+        if (!busy) {
+            const auto deadline = last_activity_ + IDLE_TIMEOUT;
+            if (now >= deadline) {
+                return Abort(beast::error::timeout, "read");
+            }
+            idle_timer_.expires_at(deadline);
+            return WaitIdle();
+        }
+
+        //    ,   ,      .
+        //    ,       
+        auto deadline = now + IDLE_TIMEOUT;
+        // sendfile     tcp_stream,      :
+        // ,   ,    
+        if (writing_ && file_serializer_) {
+            const auto write_deadline = file_progress_ + WRITE_TIMEOUT;
+            if (now >= write_deadline) {
+                return Abort(beast::error::timeout, "sendfile");
+            }
+            deadline = std::min(deadline, write_deadline);
+        }
+        for (auto sequence = next_response_; sequence != next_request_; ++sequence) {
+            const auto& pending = pending_[sequence % MAX_PIPELINED_REQUESTS];
+            if (!pending.response) {
+                const auto response_deadline = pending.received + RESPONSE_TIMEOUT;
+                if (now >= response_deadline) {
+                    return Abort(beast::error::timeout, "response");
+                }
+                deadline = std::min(deadline, response_deadline);
+                break;
+            }
+        }
+        idle_timer_.expires_at(deadline);
+        WaitIdle();
+    }
+
+    bool Session::HasPendingResponses() const noexcept {
+        return writing_ || next_response_ != next_request_;
+    }
+
+    void Session::Abort(beast::error_code ec, std::string_view what) {
+        //       ,     
+        if (aborted_.exchange(true)) {
+            return;
+        }
+        ReportError(ec, what);
+        read_done_ = true;
+        idle_timer_.cancel();
+        stream_.close();
     }
 
     void Session::Close() {
-        
-        stream_.socket().shutdown(tcp::socket::shutdown_send);
+        //     ,    
+        beast::error_code ec;
+        stream_.socket().shutdown(tcp::socket::shutdown_send, ec);
+        //   :        
+        idle_timer_.cancel();
+    }
+
+    ServerStats& GetServerStats() noexcept {
+        static ServerStats stats;
+        return stats;
     }
 
     void ReportError(beast::error_code ec, std::string_view what) {
-        std::cerr << what << ": " << ec.message() << std::endl;
+        logger::Logger::GetInstance().Log("error", {
+            { "code", ec.value() },
+            { "text", ec.message() },
+            { "where", what } });
     }
 
 }  // namespace http_server
\ No newline at end of file
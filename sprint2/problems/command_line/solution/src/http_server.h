@@ -1,8 +1,20 @@
 #pragma once
 #include "sdk.h"
+#include "http_response.h"
+#include "sharded_counter.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <iostream>
 #include <memory>
+#include <optional>
+#include <string>
+#include <stdexcept>
+#include <variant>
+#include <vector>
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/asio/strand.hpp>
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
@@ -14,44 +26,144 @@ namespace http_server {
     namespace http = beast::http;
     using tcp = net::ip::tcp;
 
-    using RequestHandler = std::function<void(
-        http::request<http::string_body>&& req,
-        std::function<void(http::response<http::string_body>&&)>&& send)>;
+    using RequestHandler = std::function<void(StringRequest&& req, ResponseSender&& send)>;
+
+#ifdef SO_REUSEPORT
+    using ReusePort = net::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+#endif
 
     void ReportError(beast::error_code ec, std::string_view what);
 
+    //       
+    struct ServerStats {
+        util::ShardedGauge active_sessions;
+        util::ShardedCounter requests;
+        util::ShardedCounter bytes_sent;
+    };
+
+    ServerStats& GetServerStats() noexcept;
+
+    //      (HTTP pipelining):   ,
+    //     ,        
     class Session : public std::enable_shared_from_this<Session> {
     public:
+        //      .  :  
+        //   MAX_PIPELINED_REQUESTS    
+        static constexpr std::size_t MAX_PIPELINED_REQUESTS = 16;
+        static constexpr auto IDLE_TIMEOUT = std::chrono::seconds(30);
+        static constexpr auto WRITE_TIMEOUT = std::chrono::seconds(30);
+        //       .    
+        // (     30 ),    
+        static constexpr auto RESPONSE_TIMEOUT = std::chrono::seconds(60);
+
         template <typename Handler>
-        Session(tcp::socket&& socket, Handler&& handler)
+        Session(tcp::socket&& socket, Handler&& handler, RequestObserver observer = {})
             : stream_(std::move(socket))
-            , request_handler_(std::forward<Handler>(handler)) {
+            , idle_timer_(stream_.get_executor())
+            , request_handler_(std::forward<Handler>(handler))
+            , observer_(std::move(observer)) {
+            GetServerStats().active_sessions.Add(1);
+        }
+
+        ~Session() {
+            GetServerStats().active_sessions.Sub(1);
         }
 
         void Run();
 
     private:
+        friend class ResponseSender;
+
+        //    :     ,     
+        using BatchSerializer = std::variant<
+            http::response_serializer<StringBody, Fields>,
+            http::response_serializer<SharedBufferBody, Fields>>;
+
+        // ,   
+        struct Pending {
+            RequestTimings timings;
+            std::chrono::steady_clock::time_point received;
+            std::chrono::steady_clock::time_point ready;
+            std::optional<Response> response;
+            std::optional<BatchSerializer> serializer;
+        };
+
         void Read();
-        void OnRead(beast::error_code ec, std::size_t bytes_read);
-        void OnWrite(bool close, beast::error_code ec, std::size_t bytes_written);
+        void ReadSome();
+        void OnReadSome(beast::error_code ec, std::size_t);
+        void OnRead(beast::error_code ec);
+        void OnResponse(std::uint64_t sequence, Response&& response);
+        //  :        
+        void OnSent(Pending& pending, std::chrono::steady_clock::time_point now);
+
+        //     ,   next_response_
+        void WriteNext();
+        void WriteBatch();
+        void WriteFile();
+        //   remain  ,   offset
+        void SendFileBody(std::uint64_t offset, std::uint64_t remain);
+        void OnWrite(std::size_t count, bool close, beast::error_code ec, std::size_t bytes_written);
+
+        void WaitIdle();
+        void OnIdleTimer(beast::error_code ec);
+        bool HasPendingResponses() const noexcept;
         void Close();
+        //    ,   
+        void Abort(beast::error_code ec, std::string_view what);
 
         beast::tcp_stream stream_;
         beast::flat_buffer buffer_;
-        http::request<http::string_body> request_;
+        net::steady_timer idle_timer_;
+        std::chrono::steady_clock::time_point last_activity_ = std::chrono::steady_clock::now();
+        //           keep-alive 
+        std::optional<http::request_parser<StringBody, util::RecyclingAllocator<char>>> parser_;
+        //      
+        std::optional<std::chrono::steady_clock::time_point> read_started_;
+        StringRequest request_;
+        //    n    n % MAX_PIPELINED_REQUESTS
+        std::array<Pending, MAX_PIPELINED_REQUESTS> pending_;
+        std::optional<http::response_serializer<FileRangeBody, Fields>> file_serializer_;
+        //      
+        std::chrono::steady_clock::time_point file_progress_;
+        std::vector<net::const_buffer> write_buffers_;
+        std::string remote_ip_;
+        //       (127.0.0.0/8).    
+        bool loopback_ = false;
+        //         
+        std::uint64_t next_request_ = 0;
+        std::uint64_t next_response_ = 0;
+        bool reading_ = false;
+        bool writing_ = false;
+        //    :   ,   keep-alive  
+        bool read_done_ = false;
+        //  .     : ,   ,
+        //    ResponseSender::IsAborted
+        std::atomic<bool> aborted_{ false };
         RequestHandler request_handler_;
+        RequestObserver observer_;
     };
 
     template <typename RequestHandler>
     class Listener : public std::enable_shared_from_this<Listener<RequestHandler>> {
     public:
+        // reuse_port   Listener'    (SO_REUSEPORT):
+        //        
         template <typename Handler>
-        Listener(net::io_context& ioc, const tcp::endpoint& endpoint, Handler&& handler)
+        Listener(net::io_context& ioc, const tcp::endpoint& endpoint, Handler&& handler, bool reuse_port = false,
+            RequestObserver observer = {})
             : ioc_(ioc)
             , acceptor_(net::make_strand(ioc))
-            , request_handler_(std::forward<Handler>(handler)) {
+            , request_handler_(std::forward<Handler>(handler))
+            , observer_(std::move(observer)) {
             acceptor_.open(endpoint.protocol());
             acceptor_.set_option(net::socket_base::reuse_address(true));
+            if (reuse_port) {
+#ifdef SO_REUSEPORT
+                acceptor_.set_option(ReusePort(true));
+#else
+                throw std::runtime_error("SO_REUSEPORT is not supported on this platform");
+#endif
+            }
             acceptor_.bind(endpoint);
             acceptor_.listen(net::socket_base::max_listen_connections);
         }
@@ -72,19 +184,28 @@ namespace http_server {
                 return ReportError(ec, "accept");
             }
 
-            std::make_shared<Session>(std::move(socket), request_handler_)->Run();
+            std::make_shared<Session>(std::move(socket), request_handler_, observer_)->Run();
             DoAccept();
         }
 
         net::io_context& ioc_;
         tcp::acceptor acceptor_;
         RequestHandler request_handler_;
+        RequestObserver observer_;
     };
 
+    //   acceptor'      contexts. ,  acceptor',
+    //    io_context.   ,    :
+    // acceptor'    SO_REUSEPORT,     ,
+    //    -        .
+    // observer,  ,      
     template <typename RequestHandler>
-    void ServeHttp(net::io_context& ioc, const tcp::endpoint& endpoint, RequestHandler&& handler) {
-        std::make_shared<Listener<std::decay_t<RequestHandler>>>(
-            ioc, endpoint, std::forward<RequestHandler>(handler))->Run();
+    void ServeHttp(const std::vector<net::io_context*>& contexts, const tcp::endpoint& endpoint,
+        RequestHandler&& handler, RequestObserver observer = {}) {
+        using Handler = std::decay_t<RequestHandler>;
+        for (auto* ioc : contexts) {
+            std::make_shared<Listener<Handler>>(*ioc, endpoint, Handler(handler), contexts.size() > 1, observer)->Run();
+        }
     }
 
 }  // namespace http_server
\ No newline at end of file
@@ -79,6 +79,8 @@ namespace json_loader {
                 map.AddOffice(ParseOffice(office_val.as_object()));
             }
 
+            map.BuildIndex();
+
             return map;
         }
 
@@ -0,0 +1,161 @@
+#pragma once
+#include <charconv>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace util {
+
+    // Потоковая запись JSON прямо в строку-буфер без промежуточного дерева значений.
+    // Буфер не очищается, поэтому его можно переиспользовать между запросами и не выделять память заново.
+    class JsonWriter {
+    public:
+        explicit JsonWriter(std::string& out) noexcept
+            : out_(out) {
+        }
+
+        JsonWriter& BeginObject() {
+            Open('{');
+            return *this;
+        }
+
+        JsonWriter& EndObject() {
+            Close('}');
+            return *this;
+        }
+
+        JsonWriter& BeginArray() {
+            Open('[');
+            return *this;
+        }
+
+        JsonWriter& EndArray() {
+            Close(']');
+            return *this;
+        }
+
+        JsonWriter& Key(std::string_view key) {
+            Separate();
+            WriteString(key);
+            out_ += ':';
+            after_key_ = true;
+            return *this;
+        }
+
+        // Числовой ключ, например id игрока, без временной строки std::to_string
+        JsonWriter& Key(uint64_t key) {
+            Separate();
+            out_ += '"';
+            WriteNumber(key);
+            out_ += "\":";
+            after_key_ = true;
+            return *this;
+        }
+
+        JsonWriter& Value(std::string_view value) {
+            Separate();
+            WriteString(value);
+            return *this;
+        }
+
+        JsonWriter& Value(const char* value) {
+            return Value(std::string_view{ value });
+        }
+
+        template <std::integral Integer>
+        JsonWriter& Value(Integer value) {
+            Separate();
+            WriteNumber(value);
+            return *this;
+        }
+
+        JsonWriter& Value(double value) {
+            Separate();
+            if (!std::isfinite(value)) {
+                out_ += "null";
+                return *this;
+            }
+            // Целые значения пишутся как 1.0, чтобы клиенты разбирали их как числа с плавающей точкой
+            char buf[32];
+            auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+            out_.append(buf, end);
+            if (std::string_view{ buf, static_cast<size_t>(end - buf) }.find_first_of(".e") == std::string_view::npos) {
+                out_ += ".0";
+            }
+            return *this;
+        }
+
+    private:
+        static constexpr int MAX_DEPTH = 64;
+
+        template <std::integral Integer>
+        void WriteNumber(Integer value) {
+            char buf[32];
+            auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+            out_.append(buf, end);
+        }
+
+        void Open(char bracket) {
+            Separate();
+            out_ += bracket;
+            ++depth_;
+            has_items_ &= ~DepthBit();
+        }
+
+        void Close(char bracket) {
+            out_ += bracket;
+            --depth_;
+        }
+
+        // Ставит запятую перед очередным элементом объекта или массива
+        void Separate() {
+            if (after_key_) {
+                after_key_ = false;
+                return;
+            }
+            if (depth_ == 0) {
+                return;
+            }
+            if (has_items_ & DepthBit()) {
+                out_ += ',';
+            }
+            has_items_ |= DepthBit();
+        }
+
+        uint64_t DepthBit() const noexcept {
+            return uint64_t{ 1 } << (depth_ % MAX_DEPTH);
+        }
+
+        void WriteString(std::string_view value) {
+            static constexpr char HEX[] = "0123456789abcdef";
+            out_ += '"';
+            for (const char c : value) {
+                switch (c) {
+                case '"': out_ += "\\\""; break;
+                case '\\': out_ += "\\\\"; break;
+                case '\n': out_ += "\\n"; break;
+                case '\r': out_ += "\\r"; break;
+                case '\t': out_ += "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        out_ += "\\u00";
+                        out_ += HEX[(c >> 4) & 0xF];
+                        out_ += HEX[c & 0xF];
+                    }
+                    else {
+                        out_ += c;
+                    }
+                }
+            }
+            out_ += '"';
+        }
+
+        std::string& out_;
+        uint64_t has_items_ = 0;
+        int depth_ = 0;
+        bool after_key_ = false;
+    };
+
+} // namespace util
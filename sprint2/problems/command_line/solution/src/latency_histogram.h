@@ -0,0 +1,97 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+namespace util {
+
+    // Гистограмма задержек в духе HDR: значения до 2 * SUB_BUCKETS хранятся точно, дальше каждая
+    // октава делится на SUB_BUCKETS равных корзин, поэтому относительная погрешность не больше
+    // 1 / SUB_BUCKETS. Запись — один атомарный инкремент без блокировок, её можно делать из любых потоков
+    class LatencyHistogram {
+    public:
+        static constexpr unsigned SUB_BUCKET_BITS = 6;
+        static constexpr uint64_t SUB_BUCKETS = uint64_t{ 1 } << SUB_BUCKET_BITS;
+        // Значения больше 2^MAX_BITS - 1 (в микросекундах это около 19 часов) попадают в последнюю корзину
+        static constexpr unsigned MAX_BITS = 36;
+        static constexpr uint64_t MAX_VALUE = (uint64_t{ 1 } << MAX_BITS) - 1;
+        static constexpr size_t BUCKET_COUNT = 2 * SUB_BUCKETS + (MAX_BITS - SUB_BUCKET_BITS - 1) * SUB_BUCKETS;
+
+        void Record(uint64_t value) noexcept {
+            value = std::min(value, MAX_VALUE);
+            counts_[IndexOf(value)].fetch_add(1, std::memory_order_relaxed);
+            auto max = max_.load(std::memory_order_relaxed);
+            while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+            }
+        }
+
+        uint64_t GetCount() const noexcept {
+            uint64_t total = 0;
+            for (const auto& count : counts_) {
+                total += count.load(std::memory_order_relaxed);
+            }
+            return total;
+        }
+
+        uint64_t GetMax() const noexcept {
+            return max_.load(std::memory_order_relaxed);
+        }
+
+        // Значение, не меньше которого percentile процентов записей (с точностью до корзины).
+        // Снимок не атомарен: записи, идущие во время подсчёта, могут учесться частично
+        uint64_t GetValueAtPercentile(double percentile) const noexcept {
+            std::array<uint64_t, BUCKET_COUNT> counts;
+            uint64_t total = 0;
+            for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+                counts[i] = counts_[i].load(std::memory_order_relaxed);
+                total += counts[i];
+            }
+            if (total == 0) {
+                return 0;
+            }
+
+            const auto target = std::max<uint64_t>(1,
+                static_cast<uint64_t>(std::ceil(std::clamp(percentile, 0.0, 100.0) / 100.0 * static_cast<double>(total))));
+            uint64_t seen = 0;
+            for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+                seen += counts[i];
+                if (seen >= target) {
+                    return std::min(HighestValueOf(i), GetMax());
+                }
+            }
+            return GetMax();
+        }
+
+        // Номер корзины для значения
+        static constexpr size_t IndexOf(uint64_t value) noexcept {
+            if (value < 2 * SUB_BUCKETS) {
+                return static_cast<size_t>(value);
+            }
+            const unsigned shift = static_cast<unsigned>(std::bit_width(value)) - 1 - SUB_BUCKET_BITS;
+            return static_cast<size_t>(2 * SUB_BUCKETS + (shift - 1) * SUB_BUCKETS + (value >> shift) - SUB_BUCKETS);
+        }
+
+        // Наибольшее значение, попадающее в корзину index
+        static constexpr uint64_t HighestValueOf(size_t index) noexcept {
+            if (index < 2 * SUB_BUCKETS) {
+                return index;
+            }
+            const uint64_t offset = index - 2 * SUB_BUCKETS;
+            const unsigned shift = static_cast<unsigned>(offset / SUB_BUCKETS) + 1;
+            const uint64_t top = SUB_BUCKETS + offset % SUB_BUCKETS;
+            return ((top + 1) << shift) - 1;
+        }
+
+    private:
+        std::array<std::atomic<uint64_t>, BUCKET_COUNT> counts_{};
+        std::atomic<uint64_t> max_{ 0 };
+    };
+
+    static_assert(LatencyHistogram::IndexOf(LatencyHistogram::MAX_VALUE) == LatencyHistogram::BUCKET_COUNT - 1);
+    static_assert(LatencyHistogram::HighestValueOf(LatencyHistogram::IndexOf(1000)) >= 1000
+        && LatencyHistogram::HighestValueOf(LatencyHistogram::IndexOf(1000) - 1) < 1000);
+
+} // namespace util
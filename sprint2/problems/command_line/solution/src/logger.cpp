@@ -1 +1,336 @@
-#include "logger.h"
\ No newline at end of file
+#include "logger.h"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace logger {
+
+    namespace {
+
+        void AppendJsonString(std::string& out, std::string_view text) {
+            constexpr char HEX[] = "0123456789abcdef";
+            out += '"';
+            for (const char c : text) {
+                switch (c) {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        out += "\\u00";
+                        out += HEX[(c >> 4) & 0xF];
+                        out += HEX[c & 0xF];
+                    }
+                    else {
+                        out += c;
+                    }
+                }
+            }
+            out += '"';
+        }
+
+        template <typename T>
+        void AppendNumber(std::string& out, T value) {
+            std::array<char, 32> buffer;
+            auto [end, ec] = std::to_chars(buffer.data(), buffer.data() + buffer.size(), value);
+            out.append(buffer.data(), end);
+        }
+
+        // "2024-01-01T00:00:00.000000Z". Дата и время до секунд форматируются
+        // один раз в секунду на поток, остальное — только микросекунды
+        void AppendTimestamp(std::string& out, std::chrono::system_clock::time_point time) {
+            using namespace std::chrono;
+            thread_local std::int64_t cached_second = -1;
+            thread_local std::array<char, 20> cached_text{};
+
+            const auto us = duration_cast<microseconds>(time.time_since_epoch()).count();
+            const auto second = us >= 0 ? us / 1'000'000 : (us - 999'999) / 1'000'000;
+            if (second != cached_second) {
+                const std::time_t t = static_cast<std::time_t>(second);
+                std::tm tm{};
+                gmtime_r(&t, &tm);
+                std::strftime(cached_text.data(), cached_text.size(), "%Y-%m-%dT%H:%M:%S", &tm);
+                cached_second = second;
+            }
+
+            const auto fraction = static_cast<unsigned>(us - second * 1'000'000);
+            std::array<char, 8> micro = { '.', '0', '0', '0', '0', '0', '0', 'Z' };
+            for (unsigned i = 0, value = fraction; i < 6; ++i, value /= 10) {
+                micro[6 - i] = static_cast<char>('0' + value % 10);
+            }
+            out += '"';
+            out.append(cached_text.data(), 19);
+            out.append(micro.data(), micro.size());
+            out += '"';
+        }
+
+    }  // namespace
+
+    void LogValue::AppendTo(std::string& out) const {
+        std::visit([&out](const auto value) {
+            using T = std::decay_t<decltype(value)>;
+            if constexpr (std::is_same_v<T, std::string_view>) {
+                AppendJsonString(out, value);
+            }
+            else if constexpr (std::is_same_v<T, bool>) {
+                out += value ? "true" : "false";
+            }
+            else {
+                AppendNumber(out, value);
+            }
+        }, value_);
+    }
+
+    // Кольцевой буфер байт с одним писателем (поток-владелец) и одним читателем (фоновый поток).
+    // В буфер попадают только целые строки: head_ сдвигается после того, как запись скопирована
+    class Logger::ThreadBuffer {
+    public:
+        bool TryPush(std::string_view record) noexcept {
+            const size_t head = head_.load(std::memory_order_relaxed);
+            const size_t tail = tail_.load(std::memory_order_acquire);
+            if (BUFFER_SIZE - (head - tail) < record.size()) {
+                return false;
+            }
+            const size_t pos = head % BUFFER_SIZE;
+            const size_t first = std::min(record.size(), BUFFER_SIZE - pos);
+            std::memcpy(data_.get() + pos, record.data(), first);
+            std::memcpy(data_.get(), record.data() + first, record.size() - first);
+            head_.store(head + record.size(), std::memory_order_release);
+            return true;
+        }
+
+        // Добавляет в iov до двух непрерывных участков с готовыми данными
+        size_t Collect(std::vector<iovec>& iov) const noexcept {
+            const size_t tail = tail_.load(std::memory_order_relaxed);
+            const size_t size = head_.load(std::memory_order_acquire) - tail;
+            if (size == 0) {
+                return 0;
+            }
+            const size_t pos = tail % BUFFER_SIZE;
+            const size_t first = std::min(size, BUFFER_SIZE - pos);
+            iov.push_back({ data_.get() + pos, first });
+            if (first < size) {
+                iov.push_back({ data_.get(), size - first });
+            }
+            return size;
+        }
+
+        void Consume(size_t bytes) noexcept {
+            tail_.store(tail_.load(std::memory_order_relaxed) + bytes, std::memory_order_release);
+        }
+
+        bool Empty() const noexcept {
+            return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_relaxed);
+        }
+
+        // Поток-владелец завершился: после опустошения буфер можно удалить
+        std::atomic<bool> retired{ false };
+
+    private:
+        std::unique_ptr<char[]> data_ = std::make_unique<char[]>(BUFFER_SIZE);
+        alignas(64) std::atomic<size_t> head_{ 0 };
+        alignas(64) std::atomic<size_t> tail_{ 0 };
+    };
+
+    struct Logger::ThreadBufferOwner {
+        std::shared_ptr<ThreadBuffer> buffer;
+
+        ~ThreadBufferOwner() {
+            if (buffer) {
+                buffer->retired.store(true, std::memory_order_release);
+            }
+        }
+    };
+
+    Logger::Logger()
+        : writer_([this](std::stop_token stop) { Run(stop); }) {
+    }
+
+    Logger::~Logger() {
+        writer_.request_stop();
+        writer_.join();
+        if (fd_ > STDERR_FILENO) {
+            ::close(fd_);
+        }
+    }
+
+    void Logger::Log(std::string_view message, std::initializer_list<LogField> data) {
+        thread_local std::string record = [] {
+            std::string text;
+            text.reserve(1024);
+            return text;
+        }();
+
+        record.clear();
+        record += "{\"timestamp\":";
+        AppendTimestamp(record, Now());
+        record += ",\"data\":{";
+        bool first = true;
+        for (const auto& field : data) {
+            if (!first) {
+                record += ',';
+            }
+            first = false;
+            AppendJsonString(record, field.key);
+            record += ':';
+            field.value.AppendTo(record);
+        }
+        record += "},\"message\":";
+        AppendJsonString(record, message);
+        record += "}\n";
+
+        if (record.size() > BUFFER_SIZE || !GetThreadBuffer().TryPush(record)) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void Logger::SetTimestamp(std::chrono::system_clock::time_point timestamp) {
+        using namespace std::chrono;
+        timestamp_override_.store(duration_cast<microseconds>(timestamp.time_since_epoch()).count(),
+            std::memory_order_relaxed);
+    }
+
+    std::uint64_t Logger::GetDroppedCount() const noexcept {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+    Logger::ThreadBuffer& Logger::GetThreadBuffer() {
+        thread_local ThreadBufferOwner owner;
+        if (!owner.buffer) {
+            owner.buffer = std::make_shared<ThreadBuffer>();
+            std::lock_guard lock{ buffers_mutex_ };
+            buffers_.push_back(owner.buffer);
+        }
+        return *owner.buffer;
+    }
+
+    std::chrono::system_clock::time_point Logger::Now() const noexcept {
+        if (const auto us = timestamp_override_.load(std::memory_order_relaxed); us != 0) {
+            return std::chrono::system_clock::time_point{ std::chrono::microseconds{ us } };
+        }
+        return std::chrono::system_clock::now();
+    }
+
+    void Logger::Run(std::stop_token stop) {
+        while (!stop.stop_requested()) {
+            if (!Drain()) {
+                std::unique_lock lock{ wake_mutex_ };
+                wake_.wait_for(lock, stop, FLUSH_INTERVAL, [] { return false; });
+            }
+        }
+        // Дописываем то, что успели записать до остановки
+        while (Drain()) {
+        }
+    }
+
+    bool Logger::Drain() {
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+        {
+            std::lock_guard lock{ buffers_mutex_ };
+            // Буферы завершившихся потоков удаляем, когда из них всё прочитано
+            std::erase_if(buffers_, [](const auto& buffer) {
+                return buffer->retired.load(std::memory_order_acquire) && buffer->Empty();
+            });
+            buffers = buffers_;
+        }
+
+        const bool has_data = std::any_of(buffers.begin(), buffers.end(), [](const auto& buffer) {
+            return !buffer->Empty();
+        });
+        if (has_data) {
+            WriteAll(buffers);
+        }
+
+        if (const auto dropped = dropped_.load(std::memory_order_relaxed); dropped != reported_dropped_) {
+            const auto count = dropped - reported_dropped_;
+            reported_dropped_ = dropped;
+            Log("log records dropped", { { "count", count } });
+        }
+        return has_data;
+    }
+
+    void Logger::WriteAll(std::vector<std::shared_ptr<ThreadBuffer>>& buffers) {
+        UpdateLogFile(Now());
+
+        std::vector<iovec> iov;
+        std::vector<size_t> sizes;
+        iov.reserve(buffers.size() * 2);
+        sizes.reserve(buffers.size());
+        for (const auto& buffer : buffers) {
+            sizes.push_back(buffer->Collect(iov));
+        }
+
+        // writev может записать не всё: продолжаем с места остановки
+        size_t index = 0;
+        while (index < iov.size()) {
+            const int count = static_cast<int>(std::min<size_t>(iov.size() - index, IOV_MAX));
+            const auto written = ::writev(fd_, iov.data() + index, count);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                // Диск недоступен: записи теряются, но потоки, пишущие в лог, не останавливаются
+                break;
+            }
+            auto remain = static_cast<size_t>(written);
+            while (index < iov.size() && remain >= iov[index].iov_len) {
+                remain -= iov[index].iov_len;
+                ++index;
+            }
+            if (remain > 0) {
+                iov[index].iov_base = static_cast<char*>(iov[index].iov_base) + remain;
+                iov[index].iov_len -= remain;
+            }
+        }
+
+        for (size_t i = 0; i < buffers.size(); ++i) {
+            buffers[i]->Consume(sizes[i]);
+        }
+    }
+
+    // Файл меняется раз в сутки: sample_log_YYYY_MM_DD.log по местному времени
+    void Logger::UpdateLogFile(std::chrono::system_clock::time_point now) {
+        if (fd_ >= 0 && now - date_checked_ < std::chrono::seconds(1) && now >= date_checked_) {
+            return;
+        }
+        date_checked_ = now;
+
+        const std::time_t t = std::chrono::system_clock::to_time_t(now);
+        std::tm tm{};
+        localtime_r(&t, &tm);
+        std::array<char, 16> date;
+        std::strftime(date.data(), date.size(), "%Y_%m_%d", &tm);
+        if (current_date_ == date.data() && fd_ >= 0) {
+            return;
+        }
+
+        std::error_code ec;
+        fs::create_directories(log_dir_, ec);
+        const auto path = log_dir_ / ("sample_log_" + std::string(date.data()) + ".log");
+        const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            if (fd_ < 0) {
+                std::cerr << "Failed to open log file " << path << ", logging to stdout" << std::endl;
+                fd_ = STDOUT_FILENO;
+            }
+        }
+        else {
+            if (fd_ > STDERR_FILENO) {
+                ::close(fd_);
+            }
+            fd_ = fd;
+        }
+        current_date_ = date.data();
+    }
+
+} // namespace logger
@@ -1,17 +1,69 @@
 #pragma once
+#include <atomic>
 #include <chrono>
-#include <string_view>
-#include <fstream>
-#include <iomanip>
-#include <mutex>
+#include <concepts>
+#include <condition_variable>
+#include <cstdint>
 #include <filesystem>
-#include <optional>
-#include <sstream>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <variant>
+#include <vector>
 
 namespace logger {
 
     namespace fs = std::filesystem;
 
+    // Значение поля структурированной записи. Строки не копируются: запись форматируется
+    // прямо в вызове Log, пока данные вызывающего ещё живы
+    class LogValue {
+    public:
+        LogValue(std::string_view value) noexcept
+            : value_(value) {
+        }
+        LogValue(const char* value) noexcept
+            : value_(std::string_view{ value }) {
+        }
+        LogValue(const std::string& value) noexcept
+            : value_(std::string_view{ value }) {
+        }
+        LogValue(bool value) noexcept
+            : value_(value) {
+        }
+        template <std::integral T>
+            requires (!std::same_as<T, bool> && !std::same_as<T, char>)
+        LogValue(T value) noexcept {
+            if constexpr (std::is_signed_v<T>) {
+                value_ = static_cast<std::int64_t>(value);
+            }
+            else {
+                value_ = static_cast<std::uint64_t>(value);
+            }
+        }
+        LogValue(double value) noexcept
+            : value_(value) {
+        }
+
+        // Дописывает значение в формате JSON
+        void AppendTo(std::string& out) const;
+
+    private:
+        std::variant<std::string_view, std::int64_t, std::uint64_t, double, bool> value_;
+    };
+
+    struct LogField {
+        std::string_view key;
+        LogValue value;
+    };
+
+    // Асинхронный логгер структурированных JSON записей. Каждый поток пишет в собственный
+    // кольцевой буфер без блокировок, фоновый поток забирает записи из всех буферов
+    // и сбрасывает их в файл пачками через writev. Вызывающий поток никогда не ждёт диска:
+    // если буфер переполнен, запись отбрасывается и учитывается в GetDroppedCount
     class Logger {
     public:
         static Logger& GetInstance() {
@@ -24,70 +76,49 @@ namespace logger {
         Logger(Logger&&) = delete;
         Logger& operator=(Logger&&) = delete;
 
-        template <typename... Args>
-        void Log(Args&&... args) {
-            std::lock_guard lock(mutex_);
-
-            auto now = timestamp_override_.has_value() ?
-                timestamp_override_.value() : std::chrono::system_clock::now();
+        // {"timestamp":"2024-01-01T00:00:00.000000Z","data":{...},"message":"..."}
+        void Log(std::string_view message, std::initializer_list<LogField> data = {});
 
-            UpdateLogFile(now);
-            WriteTimestamp(now);
-            (log_file_ << ... << std::forward<Args>(args)) << std::endl;
-        }
+        // Подменяет время записей (для воспроизводимого вывода)
+        void SetTimestamp(std::chrono::system_clock::time_point timestamp);
 
-        void SetTimestamp(std::chrono::system_clock::time_point timestamp) {
-            std::lock_guard lock(mutex_);
-            timestamp_override_ = timestamp;
-        }
+        std::uint64_t GetDroppedCount() const noexcept;
 
     private:
-        Logger() = default;
-        ~Logger() {
-            if (log_file_.is_open()) {
-                log_file_.close();
-            }
-        }
+        class ThreadBuffer;
+        struct ThreadBufferOwner;
 
-        void UpdateLogFile(const std::chrono::system_clock::time_point& now) {
-            auto new_date = GetDate(now);
-            if (current_date_ != new_date) {
-                if (log_file_.is_open()) {
-                    log_file_.close();
-                }
-
-                fs::path log_dir = "/var/log";
-                if (!fs::exists(log_dir)) {
-                    fs::create_directory(log_dir);
-                }
-
-                std::ostringstream filename;
-                auto t = std::chrono::system_clock::to_time_t(now);
-                auto tm = *std::localtime(&t);
-                filename << "sample_log_"
-                    << std::put_time(&tm, "%Y_%m_%d") << ".log";
-
-                log_file_.open(log_dir / filename.str(), std::ios::app);
-                current_date_ = new_date;
-            }
-        }
+        // Размер кольцевого буфера одного потока
+        static constexpr size_t BUFFER_SIZE = 256 * 1024;
+        static constexpr auto FLUSH_INTERVAL = std::chrono::milliseconds(10);
 
-        void WriteTimestamp(const std::chrono::system_clock::time_point& now) {
-            auto t = std::chrono::system_clock::to_time_t(now);
-            log_file_ << std::put_time(std::localtime(&t), "%F %T") << ": ";
-        }
+        Logger();
+        ~Logger();
 
-        static std::string GetDate(const std::chrono::system_clock::time_point& tp) {
-            auto t = std::chrono::system_clock::to_time_t(tp);
-            std::ostringstream oss;
-            oss << std::put_time(std::localtime(&t), "%F");
-            return oss.str();
-        }
+        ThreadBuffer& GetThreadBuffer();
+        std::chrono::system_clock::time_point Now() const noexcept;
+
+        void Run(std::stop_token stop);
+        // Записывает всё накопленное. Возвращает false, если писать было нечего
+        bool Drain();
+        void UpdateLogFile(std::chrono::system_clock::time_point now);
+        void WriteAll(std::vector<std::shared_ptr<ThreadBuffer>>& buffers);
 
-        std::ofstream log_file_;
+        fs::path log_dir_ = "/var/log";
+        int fd_ = -1;
         std::string current_date_;
-        std::optional<std::chrono::system_clock::time_point> timestamp_override_;
-        std::mutex mutex_;
+        std::chrono::system_clock::time_point date_checked_;
+
+        std::mutex buffers_mutex_;
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+        // Метка времени в микросекундах от эпохи, 0 — текущее время
+        std::atomic<std::int64_t> timestamp_override_{ 0 };
+        std::atomic<std::uint64_t> dropped_{ 0 };
+        std::uint64_t reported_dropped_ = 0;
+
+        std::mutex wake_mutex_;
+        std::condition_variable_any wake_;
+        std::jthread writer_;
     };
 
-} // namespace logger
\ No newline at end of file
+} // namespace logger
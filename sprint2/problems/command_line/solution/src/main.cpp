@@ -3,12 +3,19 @@
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/signal_set.hpp>
 #include <boost/program_options.hpp>
+#include <algorithm>
+#include <cctype>
+#include <charconv>
 #include <iostream>
+#include <memory>
 #include <thread>
+#include <vector>
 #include "json_loader.h"
 #include "request_handler.h"
 #include "ticker.h"
+#include "map_strands.h"
 #include "http_server.h"
+#include "logger.h"
 
 using namespace std::literals;
 namespace net = boost::asio;
@@ -22,8 +29,13 @@ namespace {
     struct Args {
         std::string config_file;          //    
         std::string www_root;             //    
+        bool www_watch;                   //     
+        http_handler::StaticCache::MaxAgeByExtension static_max_age;  // max-age   
         std::optional<int> tick_period;   //    ()
+        unsigned tick_max_steps;          //  :     , 0     
+        unsigned acceptors;               //  acceptor'  , 0      
         bool randomize_spawn_points;      //   
+        bool remote_admin;                //       localhost
     };
 
     //     
@@ -36,12 +48,24 @@ namespace {
             ("help,h", "Show help")
             ("tick-period,t", po::value<int>()->value_name("ms"),
                 "Set tick period (milliseconds) for automatic updates")
+            ("tick-max-steps", po::value(&args.tick_max_steps)->default_value(0)->value_name("count"),
+                "Advance the game in fixed steps of tick-period, at most count steps per tick "
+                "(0 - one step of the real elapsed time)")
             ("config-file,c", po::value(&args.config_file)->required()->value_name("file"),
                 "Path to game configuration file")
             ("www-root,w", po::value(&args.www_root)->required()->value_name("dir"),
                 "Path to static files directory")
+            ("www-watch", po::bool_switch(&args.www_watch),
+                "Reload static files when the www-root directory changes")
+            ("static-max-age", po::value<std::vector<std::string>>()->composing()->value_name("ext=seconds"),
+                "Cache-Control max-age for static files with the extension, e.g. .js=3600 (repeatable)")
             ("randomize-spawn-points", po::bool_switch(&args.randomize_spawn_points),
-                "Spawn dogs at random positions on roads");
+                "Spawn dogs at random positions on roads")
+            ("acceptors", po::value(&args.acceptors)->default_value(1)->value_name("count"),
+                "Number of SO_REUSEPORT acceptors on the listening port, each with its own "
+                "io_context and thread (0 - one per hardware thread)")
+            ("remote-admin", po::bool_switch(&args.remote_admin),
+                "Serve admin endpoints (/metrics, /api/v1/admin/*) to clients on other hosts, not only on localhost");
 
         po::variables_map vm;
         try {
@@ -65,6 +89,28 @@ namespace {
                 }
             }
 
+            //  static-max-age
+            if (vm.count("static-max-age")) {
+                for (const auto& rule : vm["static-max-age"].as<std::vector<std::string>>()) {
+                    const auto eq = rule.find('=');
+                    if (eq == std::string::npos || eq == 0 || rule[0] != '.') {
+                        throw std::runtime_error("Invalid static-max-age rule: " + rule);
+                    }
+                    std::string ext = rule.substr(0, eq);
+                    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) {
+                        return std::tolower(c);
+                        });
+                    //       ,    "10s"
+                    int seconds = 0;
+                    const auto value_end = rule.data() + rule.size();
+                    const auto [ptr, ec] = std::from_chars(rule.data() + eq + 1, value_end, seconds);
+                    if (ec != std::errc{} || ptr != value_end || seconds < 0) {
+                        throw std::runtime_error("Invalid static-max-age rule: " + rule);
+                    }
+                    args.static_max_age[ext] = std::chrono::seconds{ seconds };
+                }
+            }
+
             return args;
         }
         catch (const po::error& e) {
@@ -114,28 +160,56 @@ int main(int argc, const char* argv[]) {
         const unsigned num_threads = std::thread::hardware_concurrency();
         net::io_context ioc(num_threads);
 
+        //   acceptor'    io_context   :   
+        //    . ,       ioc.
+        //    : ,   ,    
+        const unsigned acceptors = args->acceptors == 0 ? std::max(1u, num_threads) : args->acceptors;
+        std::vector<std::unique_ptr<net::io_context>> acceptor_contexts;
+        std::vector<net::io_context*> http_contexts{ &ioc };
+        if (acceptors > 1) {
+            http_contexts.clear();
+            for (unsigned i = 0; i < acceptors; ++i) {
+                http_contexts.push_back(acceptor_contexts.emplace_back(std::make_unique<net::io_context>(1)).get());
+            }
+        }
+
         //   
         net::signal_set signals(ioc, SIGINT, SIGTERM);
-        signals.async_wait([&ioc](const sys::error_code& ec, int) {
+        signals.async_wait([&ioc, &acceptor_contexts](const sys::error_code& ec, int) {
             if (!ec) {
                 ioc.stop();
+                for (auto& context : acceptor_contexts) {
+                    context->stop();
+                }
                 std::cout << "Server shutdown initiated..." << std::endl;
             }
             });
 
         //   
-        auto api_strand = net::make_strand(ioc);
-        http_handler::RequestHandler handler{ *game, args->www_root, api_strand };
+        //       
+        http_handler::StaticCache static_cache{ args->www_root, args->static_max_age };
+        if (args->www_watch) {
+            static_cache.Watch(ioc);
+        }
+
+        const MapStrands map_strands{ ioc, game->GetMaps().size() };
+        http_handler::RequestMetrics metrics;
+        //      Prometheus, . /metrics
+        http_handler::MetricsExporter exporter{ *game, map_strands, metrics };
+        http_handler::RequestHandler handler{ *game, static_cache, map_strands, metrics, exporter,
+            args->remote_admin };
 
         //    (  )
         if (args->tick_period) {
             auto ticker = std::make_shared<Ticker>(
-                api_strand,
+                net::make_strand(ioc),
                 std::chrono::milliseconds(*args->tick_period),
-                [&game](std::chrono::milliseconds delta) {
-                    game->UpdateState(delta.count());
-                }
+                [&handler](std::chrono::milliseconds delta, std::function<void()> done) {
+                    handler.Tick(delta, std::move(done));
+                },
+                args->tick_max_steps
             );
+            exporter.SetTicker(ticker);
             ticker->Start();
             std::cout << "Auto-tick enabled (" << *args->tick_period << "ms)" << std::endl;
         }
@@ -147,22 +221,44 @@ int main(int argc, const char* argv[]) {
         const auto address = net::ip::make_address("0.0.0.0");
         constexpr unsigned short port = 8080;
 
-        http_server::ServeHttp(ioc, { address, port }, [&handler](auto&& req, auto&& send) {
+        //       , . /api/v1/admin/latency
+        http_server::ServeHttp(http_contexts, { address, port }, [&handler](auto&& req, auto&& send) {
             handler(std::forward<decltype(req)>(req), std::forward<decltype(send)>(send));
+            }, [&metrics](const http_server::RequestTimings& timings) {
+                metrics.Record(timings);
             });
 
         std::cout << "Server started at http://" << address << ":" << port << std::endl;
+        logger::Logger::GetInstance().Log("server started", {
+            { "port", port },
+            { "address", address.to_string() } });
         std::cout << "Config: " << args->config_file << std::endl;
         std::cout << "Static files: " << args->www_root << std::endl;
         std::cout << "Hardware concurrency: " << num_threads << " threads" << std::endl;
+        std::cout << "Acceptors: " << acceptors << std::endl;
 
-        //   
+        //  acceptor',    
+        std::vector<std::jthread> acceptor_threads;
+        acceptor_threads.reserve(acceptor_contexts.size());
+        for (auto& context : acceptor_contexts) {
+            acceptor_threads.emplace_back([&context = *context] {
+                context.run();
+                });
+        }
         RunWorkers(num_threads, [&ioc] {
             ioc.run();
             });
+        for (auto& context : acceptor_contexts) {
+            context->stop();
+        }
+        acceptor_threads.clear();
+        logger::Logger::GetInstance().Log("server exited", { { "code", EXIT_SUCCESS } });
     }
     catch (const std::exception& ex) {
         std::cerr << "Fatal error: " << ex.what() << std::endl;
+        logger::Logger::GetInstance().Log("server exited", {
+            { "code", EXIT_FAILURE },
+            { "exception", ex.what() } });
         return EXIT_FAILURE;
     }
 
@@ -1,5 +1,6 @@
 #pragma once
 #include "model.h"
+#include "spatial_index.h"
 #include <vector>
 #include <unordered_map>
 
@@ -27,6 +28,9 @@ namespace model {
         void AddBuilding(const Building& building);
         void AddOffice(Office office);
 
+        // Строит пространственный индекс; вызывается после добавления всех дорог и зданий
+        void BuildIndex();
+
         Point GetSpawnPoint() const;
         std::pair<double, double> ClampPosition(double old_x, double old_y, double new_x, double new_y) const;
 
@@ -40,6 +44,7 @@ namespace model {
         Buildings buildings_;
         Offices offices_;
         OfficeIdToIndex warehouse_id_to_index_;
+        SpatialIndex index_;
     };
 
 } // namespace model
\ No newline at end of file
@@ -0,0 +1,83 @@
+#pragma once
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/strand.hpp>
+#include "sharded_counter.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace net = boost::asio;
+
+// Свой strand для каждой карты. Всё, что читает или меняет состояние карты
+// (запросы игроков, вход в игру, тик), выполняется на strand'е этой карты,
+// поэтому разные карты обрабатываются параллельно без блокировок.
+class MapStrands {
+public:
+    using Strand = net::strand<net::io_context::executor_type>;
+
+    MapStrands(net::io_context& ioc, size_t map_count)
+        : queue_depth_(std::make_unique<util::ShardedGauge[]>(map_count)) {
+        strands_.reserve(map_count);
+        for (size_t i = 0; i < map_count; ++i) {
+            strands_.emplace_back(net::make_strand(ioc));
+        }
+    }
+
+    size_t Size() const noexcept {
+        return strands_.size();
+    }
+
+    const Strand& operator[](size_t map_index) const {
+        return strands_.at(map_index);
+    }
+
+    // Выполняет fn на strand'е карты и учитывает его в глубине очереди этого strand'а
+    template <typename Fn>
+    void Dispatch(size_t map_index, Fn&& fn) const {
+        auto& depth = queue_depth_[map_index];
+        depth.Add(1);
+        net::dispatch(strands_.at(map_index), [&depth, fn = std::forward<Fn>(fn)]() mutable {
+            depth.Sub(1);
+            fn();
+        });
+    }
+
+    // Сколько обработчиков, отправленных через Dispatch, ещё ждут своей очереди
+    int64_t GetQueueDepth(size_t map_index) const noexcept {
+        return queue_depth_[map_index].Get();
+    }
+
+    // Вызывает fn(map_index) на strand'е каждой карты. done вызывается ровно один раз,
+    // на потоке, завершившем последнюю карту
+    template <typename Fn, typename Done>
+    void ForEach(Fn fn, Done done) const {
+        struct State {
+            State(size_t count, Fn fn, Done done)
+                : remaining{ count }, fn{ std::move(fn) }, done{ std::move(done) } {}
+
+            std::atomic<size_t> remaining;
+            Fn fn;
+            Done done;
+        };
+
+        if (strands_.empty()) {
+            done();
+            return;
+        }
+
+        auto state = std::make_shared<State>(strands_.size(), std::move(fn), std::move(done));
+        for (size_t i = 0; i < strands_.size(); ++i) {
+            Dispatch(i, [state, i] {
+                state->fn(i);
+                if (state->remaining.fetch_sub(1) == 1) {
+                    state->done();
+                }
+            });
+        }
+    }
+
+private:
+    std::vector<Strand> strands_;
+    std::unique_ptr<util::ShardedGauge[]> queue_depth_;
+};
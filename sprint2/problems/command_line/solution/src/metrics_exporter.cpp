@@ -0,0 +1,81 @@
+#include "metrics_exporter.h"
+#include "http_server.h"
+#include "logger.h"
+#include "prometheus_writer.h"
+#include <chrono>
+
+namespace http_handler {
+
+    namespace {
+
+        double ToSeconds(std::chrono::microseconds duration) noexcept {
+            return std::chrono::duration<double>(duration).count();
+        }
+
+    }  // namespace
+
+    MetricsExporter::MetricsExporter(const model::Game& game, const MapStrands& map_strands,
+        const RequestMetrics& request_metrics)
+        : game_(game)
+        , map_strands_(map_strands)
+        , request_metrics_(request_metrics) {
+    }
+
+    void MetricsExporter::SetTicker(std::shared_ptr<const Ticker> ticker) {
+        ticker_ = std::move(ticker);
+    }
+
+    std::string MetricsExporter::Export() const {
+        std::string body;
+        util::PrometheusWriter writer{ body };
+
+        const auto& server = http_server::GetServerStats();
+        writer.Metric("http_active_sessions", "gauge", "Open HTTP connections")
+            .Sample("http_active_sessions", server.active_sessions.Get());
+        writer.Metric("http_requests_total", "counter", "HTTP requests received")
+            .Sample("http_requests_total", server.requests.Get());
+        writer.Metric("http_sent_bytes_total", "counter", "Bytes written to HTTP connections, headers included")
+            .Sample("http_sent_bytes_total", server.bytes_sent.Get());
+
+        writer.Metric("http_route_responses_total", "counter", "HTTP responses sent, by route");
+        for (size_t route = 0; route < RequestMetrics::ROUTE_COUNT; ++route) {
+            writer.Sample("http_route_responses_total", "route", RequestMetrics::GetRouteName(route),
+                request_metrics_.GetResponseCount(route));
+        }
+
+        const auto& maps = game_.GetMaps();
+        writer.Metric("game_players", "gauge", "Players on the map");
+        for (size_t i = 0; i < maps.size(); ++i) {
+            writer.Sample("game_players", "map", *maps[i].GetId(), game_.GetPlayerCount(i));
+        }
+        writer.Metric("game_strand_queue_depth", "gauge", "Handlers waiting on the map strand");
+        for (size_t i = 0; i < maps.size(); ++i) {
+            writer.Sample("game_strand_queue_depth", "map", *maps[i].GetId(), map_strands_.GetQueueDepth(i));
+        }
+
+        if (ticker_) {
+            const auto stats = ticker_->GetStats();
+            writer.Metric("game_ticks_total", "counter", "Automatic game ticks")
+                .Sample("game_ticks_total", stats.ticks);
+            writer.Metric("game_tick_steps_total", "counter", "Simulation steps applied by automatic ticks")
+                .Sample("game_tick_steps_total", stats.steps);
+            writer.Metric("game_tick_overruns_total", "counter", "Ticks that fired while the game was behind schedule")
+                .Sample("game_tick_overruns_total", stats.overruns);
+            writer.Metric("game_tick_dropped_steps_total", "counter", "Fixed steps dropped by the per-tick step limit")
+                .Sample("game_tick_dropped_steps_total", stats.dropped_steps);
+            writer.Metric("game_tick_duration_seconds", "gauge", "Time to apply the last tick to all maps")
+                .Sample("game_tick_duration_seconds", ToSeconds(stats.last_duration));
+            writer.Metric("game_tick_duration_max_seconds", "gauge", "Longest tick since start")
+                .Sample("game_tick_duration_max_seconds", ToSeconds(stats.max_duration));
+            writer.Metric("game_tick_lag_seconds", "gauge", "How late the last tick timer fired")
+                .Sample("game_tick_lag_seconds", ToSeconds(stats.last_lag));
+            writer.Metric("game_tick_lag_max_seconds", "gauge", "Largest tick timer lag since start")
+                .Sample("game_tick_lag_max_seconds", ToSeconds(stats.max_lag));
+        }
+
+        writer.Metric("log_dropped_records_total", "counter", "Log records dropped because a log buffer was full")
+            .Sample("log_dropped_records_total", logger::Logger::GetInstance().GetDroppedCount());
+        return body;
+    }
+
+} // namespace http_handler
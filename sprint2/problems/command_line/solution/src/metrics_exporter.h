@@ -0,0 +1,34 @@
+#pragma once
+#include "game.h"
+#include "map_strands.h"
+#include "request_metrics.h"
+#include "ticker.h"
+#include <memory>
+#include <string>
+
+namespace http_handler {
+
+    // Собирает метрики сервера и игры в текстовом формате Prometheus для /metrics.
+    // Источники пишут в свои атомарные счётчики, экспорт их только читает
+    // и не мешает обработке запросов
+    class MetricsExporter {
+    public:
+        MetricsExporter(const model::Game& game, const MapStrands& map_strands,
+            const RequestMetrics& request_metrics);
+
+        MetricsExporter(const MetricsExporter&) = delete;
+        MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+        // Ticker есть только в режиме автоматического тика. Вызывается до запуска потоков
+        void SetTicker(std::shared_ptr<const Ticker> ticker);
+
+        std::string Export() const;
+
+    private:
+        const model::Game& game_;
+        const MapStrands& map_strands_;
+        const RequestMetrics& request_metrics_;
+        std::shared_ptr<const Ticker> ticker_;
+    };
+
+} // namespace http_handler
@@ -2,6 +2,7 @@
 #include "map.h"
 #include <stdexcept>
 #include <cmath>
+#include <optional>
 
 namespace model {
     // Реализация методов классов Road, Building, Office и Map
@@ -115,38 +116,69 @@ namespace model {
         return { roads_[0].GetStart().x, roads_[0].GetStart().y };
     }
 
-    std::pair<double, double> Map::ClampPosition(double old_x, double old_y, double new_x, double new_y) const {
-        if (roads_.empty()) {
-            return { new_x, new_y };
-        }
+    void Map::BuildIndex() {
+        index_.Build(roads_, buildings_);
+    }
 
-        for (const auto& building : buildings_) {
+    namespace {
+        bool IsInsideBuilding(const Building& building, double x, double y) {
             const auto& bounds = building.GetBounds();
-            if (new_x >= bounds.position.x &&
-                new_x < bounds.position.x + bounds.size.width &&
-                new_y >= bounds.position.y &&
-                new_y < bounds.position.y + bounds.size.height) {
-                return { old_x, old_y };
-            }
+            return x >= bounds.position.x &&
+                x < bounds.position.x + bounds.size.width &&
+                y >= bounds.position.y &&
+                y < bounds.position.y + bounds.size.height;
         }
 
-        for (const auto& road : roads_) {
+        std::optional<std::pair<double, double>> ClampToRoad(const Road& road, double x, double y) {
             if (road.IsHorizontal()) {
                 const int min_x = std::min(road.GetStart().x, road.GetEnd().x);
                 const int max_x = std::max(road.GetStart().x, road.GetEnd().x);
-                if (std::abs(new_y - road.GetStart().y) < 0.5 &&
-                    new_x >= min_x - 0.5 && new_x <= max_x + 0.5) {
-                    return { new_x, static_cast<double>(road.GetStart().y) };
+                if (std::abs(y - road.GetStart().y) < 0.5 &&
+                    x >= min_x - 0.5 && x <= max_x + 0.5) {
+                    return std::pair{ x, static_cast<double>(road.GetStart().y) };
                 }
             }
             else {
                 const int min_y = std::min(road.GetStart().y, road.GetEnd().y);
                 const int max_y = std::max(road.GetStart().y, road.GetEnd().y);
-                if (std::abs(new_x - road.GetStart().x) < 0.5 &&
-                    new_y >= min_y - 0.5 && new_y <= max_y + 0.5) {
-                    return { static_cast<double>(road.GetStart().x), new_y };
+                if (std::abs(x - road.GetStart().x) < 0.5 &&
+                    y >= min_y - 0.5 && y <= max_y + 0.5) {
+                    return std::pair{ static_cast<double>(road.GetStart().x), y };
                 }
             }
+            return std::nullopt;
+        }
+    }
+
+    std::pair<double, double> Map::ClampPosition(double old_x, double old_y, double new_x, double new_y) const {
+        if (roads_.empty()) {
+            return { new_x, new_y };
+        }
+
+        if (index_.IsBuilt()) {
+            for (const auto i : index_.BuildingsAt(new_x, new_y)) {
+                if (IsInsideBuilding(buildings_[i], new_x, new_y)) {
+                    return { old_x, old_y };
+                }
+            }
+            for (const auto i : index_.RoadsAt(new_x, new_y)) {
+                if (auto clamped = ClampToRoad(roads_[i], new_x, new_y)) {
+                    return *clamped;
+                }
+            }
+            return { old_x, old_y };
+        }
+
+        // Карта без индекса (собрана вручную, без json_loader): линейный проход
+        for (const auto& building : buildings_) {
+            if (IsInsideBuilding(building, new_x, new_y)) {
+                return { old_x, old_y };
+            }
+        }
+        for (const auto& road : roads_) {
+            if (auto clamped = ClampToRoad(road, new_x, new_y)) {
+                return *clamped;
+            }
         }
 
         return { old_x, old_y };
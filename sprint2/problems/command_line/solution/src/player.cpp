@@ -1,33 +1,34 @@
 #include "player.h"
-#include <random>
+#include <stdexcept>
 
 namespace model {
 
-    std::shared_ptr<Player> Players::Add(std::string name, std::shared_ptr<Dog> dog) {
-        auto player = std::make_shared<Player>(static_cast<uint32_t>(players_.size()),
-            std::move(name), std::move(dog));
-        players_.push_back(player);
-        token_to_player_[player->GetToken()] = player;
-        dog_to_player_[dog->GetId()] = player;
-        return player;
+    const Player& Players::Add(std::string name, Dog dog, Token token) {
+        const auto id = players_.Insert(Player{ players_.NextHandle(), std::move(name), dog, token });
+        try {
+            if (!token_to_player_.Insert(token, id.GetValue())) {
+                throw std::invalid_argument("Duplicate player token");
+            }
+        } catch (...) {
+            players_.Erase(id);
+            throw;
+        }
+        return *players_.Find(id);
     }
 
-    std::shared_ptr<Player> Players::FindByToken(const Token& token) const {
-        if (auto it = token_to_player_.find(token); it != token_to_player_.end()) {
-            return it->second;
-        }
-        return nullptr;
+    const Player* Players::Find(Player::Id id) const noexcept {
+        return players_.Find(id);
     }
 
-    std::shared_ptr<Player> Players::FindByDogId(const Dog::Id& id) const {
-        if (auto it = dog_to_player_.find(id); it != dog_to_player_.end()) {
-            return it->second;
+    const Player* Players::FindByToken(const Token& token) const noexcept {
+        if (auto id = token_to_player_.Find(token)) {
+            return players_.Find(Player::Id::FromValue(*id));
         }
         return nullptr;
     }
 
-    const std::vector<std::shared_ptr<Player>>& Players::GetPlayers() const {
-        return players_;
+    size_t Players::Size() const noexcept {
+        return players_.Size();
     }
 
-}  // namespace model
\ No newline at end of file
+}  // namespace model
@@ -1,50 +1,49 @@
 #pragma once
 #include "model.h"
 #include "dog.h"
+#include "slot_map.h"
+#include "token.h"
+#include "token_index.h"
 #include <string>
-#include <memory>
-#include <unordered_map>
-#include <vector>
 
 namespace model {
 
-    namespace detail {
-        struct TokenTag {};
-    }  // namespace detail
-
-    using Token = util::Tagged<std::string, detail::TokenTag>;
-
     class Player {
     public:
-        Player(uint32_t id, std::string name, std::shared_ptr<Dog> dog)
-            : id_{ id }, name_{ std::move(name) }, dog_{ std::move(dog) }, token_{ Token{""} } {}
+        using Id = util::SlotMap<Player>::Handle;
 
-        uint32_t GetId() const { return id_; }
+        Player(Id id, std::string name, Dog dog, Token token)
+            : id_{ id }, name_{ std::move(name) }, dog_{ dog }, token_{ token } {}
+
+        Id GetId() const { return id_; }
         const std::string& GetName() const { return name_; }
-        const Dog& GetDog() const { return *dog_; }
-        Dog& GetDog() { return *dog_; }
+        const Dog& GetDog() const { return dog_; }
+        Dog& GetDog() { return dog_; }
         const Token& GetToken() const { return token_; }
-        void SetToken(Token token) { token_ = std::move(token); }
-        const std::string& GetUnderlying() const { return *token_; }
 
     private:
-        uint32_t id_;
+        Id id_;
         std::string name_;
-        std::shared_ptr<Dog> dog_;
+        Dog dog_;
         Token token_;
     };
 
+    // Игроки хранятся в плотном массиве слот-карты; снаружи на них ссылаются 32-битные Player::Id.
+    // Указатели, возвращаемые Add и Find*, действительны до следующего изменения реестра
     class Players {
     public:
-        std::shared_ptr<Player> Add(std::string name, std::shared_ptr<Dog> dog);
-        std::shared_ptr<Player> FindByToken(const Token& token) const;
-        std::shared_ptr<Player> FindByDogId(const Dog::Id& id) const;
-        const std::vector<std::shared_ptr<Player>>& GetPlayers() const;
+        const Player& Add(std::string name, Dog dog, Token token);
+        const Player* Find(Player::Id id) const noexcept;
+        const Player* FindByToken(const Token& token) const noexcept;
+        size_t Size() const noexcept;
+
+        auto begin() const noexcept { return players_.begin(); }
+        auto end() const noexcept { return players_.end(); }
 
     private:
-        std::vector<std::shared_ptr<Player>> players_;
-        std::unordered_map<Token, std::shared_ptr<Player>> token_to_player_;
-        std::unordered_map<Dog::Id, std::shared_ptr<Player>> dog_to_player_;
+        util::SlotMap<Player> players_;
+        // Токен -> Player::Id
+        TokenIndex token_to_player_;
     };
 
-}  // namespace model
\ No newline at end of file
+}  // namespace model
@@ -0,0 +1,92 @@
+#pragma once
+#include <charconv>
+#include <cmath>
+#include <concepts>
+#include <string>
+#include <string_view>
+
+namespace util {
+
+    // Текстовый формат экспорта метрик Prometheus (version 0.0.4):
+    //   # HELP name описание
+    //   # TYPE name gauge
+    //   name{label="value"} 42
+    class PrometheusWriter {
+    public:
+        static constexpr std::string_view CONTENT_TYPE = "text/plain; version=0.0.4; charset=utf-8";
+
+        explicit PrometheusWriter(std::string& out) noexcept
+            : out_(out) {
+        }
+
+        // type — counter или gauge
+        PrometheusWriter& Metric(std::string_view name, std::string_view type, std::string_view help) {
+            out_ += "# HELP ";
+            out_ += name;
+            out_ += ' ';
+            out_ += help;
+            out_ += "\n# TYPE ";
+            out_ += name;
+            out_ += ' ';
+            out_ += type;
+            out_ += '\n';
+            return *this;
+        }
+
+        template <typename Value>
+        PrometheusWriter& Sample(std::string_view name, Value value) {
+            out_ += name;
+            WriteValue(value);
+            return *this;
+        }
+
+        template <typename Value>
+        PrometheusWriter& Sample(std::string_view name, std::string_view label, std::string_view label_value,
+            Value value) {
+            out_ += name;
+            out_ += '{';
+            out_ += label;
+            out_ += "=\"";
+            for (const char c : label_value) {
+                switch (c) {
+                case '\\': out_ += "\\\\"; break;
+                case '"': out_ += "\\\""; break;
+                case '\n': out_ += "\\n"; break;
+                default: out_ += c;
+                }
+            }
+            out_ += "\"}";
+            WriteValue(value);
+            return *this;
+        }
+
+    private:
+        template <std::integral Integer>
+        void WriteValue(Integer value) {
+            char buf[32];
+            auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+            out_ += ' ';
+            out_.append(buf, end);
+            out_ += '\n';
+        }
+
+        void WriteValue(double value) {
+            out_ += ' ';
+            if (std::isnan(value)) {
+                out_ += "NaN";
+            }
+            else if (std::isinf(value)) {
+                out_ += value > 0 ? "+Inf" : "-Inf";
+            }
+            else {
+                char buf[32];
+                auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+                out_.append(buf, end);
+            }
+            out_ += '\n';
+        }
+
+        std::string& out_;
+    };
+
+} // namespace util
@@ -0,0 +1,129 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <new>
+
+namespace util {
+
+    namespace detail {
+
+        // Кэш освобождённых блоков текущего потока, разбитый на классы размеров 64 байта .. 64 КиБ.
+        // Блок может быть освобождён на другом потоке: тогда он попадает в кэш этого потока
+        class ThreadBlockCache {
+        public:
+            static void* Allocate(size_t bytes) {
+                const size_t cls = ClassOf(bytes);
+                if (cls == NO_CLASS) {
+                    return ::operator new(bytes);
+                }
+                // Размер всегда округляется до класса: блок может вернуться в кэш другого потока
+                if (destroyed_) {
+                    return ::operator new(ClassSize(cls));
+                }
+                auto& cache = Get();
+                if (FreeBlock* block = cache.heads_[cls]) {
+                    cache.heads_[cls] = block->next;
+                    --cache.counts_[cls];
+                    return block;
+                }
+                return ::operator new(ClassSize(cls));
+            }
+
+            static void Deallocate(void* ptr, size_t bytes) noexcept {
+                const size_t cls = ClassOf(bytes);
+                if (cls == NO_CLASS || destroyed_) {
+                    return ::operator delete(ptr);
+                }
+                auto& cache = Get();
+                if (cache.counts_[cls] >= MaxBlocks(cls)) {
+                    return ::operator delete(ptr);
+                }
+                cache.heads_[cls] = new (ptr) FreeBlock{ cache.heads_[cls] };
+                ++cache.counts_[cls];
+            }
+
+        private:
+            static constexpr size_t MIN_SHIFT = 6;
+            static constexpr size_t CLASS_COUNT = 11;
+            static constexpr size_t NO_CLASS = CLASS_COUNT;
+            // Сколько байт может лежать в кэше одного класса
+            static constexpr size_t MAX_CACHED_BYTES = 256 * 1024;
+
+            struct FreeBlock {
+                FreeBlock* next;
+            };
+
+            ThreadBlockCache() = default;
+
+            ~ThreadBlockCache() {
+                destroyed_ = true;
+                for (FreeBlock* head : heads_) {
+                    while (head) {
+                        FreeBlock* next = head->next;
+                        ::operator delete(head);
+                        head = next;
+                    }
+                }
+            }
+
+            static ThreadBlockCache& Get() {
+                thread_local ThreadBlockCache cache;
+                return cache;
+            }
+
+            static constexpr size_t ClassSize(size_t cls) noexcept {
+                return size_t{ 1 } << (cls + MIN_SHIFT);
+            }
+
+            static constexpr size_t ClassOf(size_t bytes) noexcept {
+                for (size_t cls = 0; cls < CLASS_COUNT; ++cls) {
+                    if (bytes <= ClassSize(cls)) {
+                        return cls;
+                    }
+                }
+                return NO_CLASS;
+            }
+
+            static constexpr size_t MaxBlocks(size_t cls) noexcept {
+                return std::clamp<size_t>(MAX_CACHED_BYTES / ClassSize(cls), 4, 64);
+            }
+
+            std::array<FreeBlock*, CLASS_COUNT> heads_{};
+            std::array<size_t, CLASS_COUNT> counts_{};
+            // Кэш потока уже разрушен (завершение потока): дальше работаем напрямую с operator new
+            static inline thread_local bool destroyed_ = false;
+        };
+
+    }  // namespace detail
+
+    // Аллокатор для короткоживущих объектов запросов и ответов: память переиспользуется
+    // через кэш потока, поэтому в установившемся режиме обращений к malloc почти нет
+    template <typename T>
+    class RecyclingAllocator {
+    public:
+        using value_type = T;
+
+        static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+
+        RecyclingAllocator() noexcept = default;
+
+        template <typename U>
+        RecyclingAllocator(const RecyclingAllocator<U>&) noexcept {
+        }
+
+        T* allocate(size_t n) {
+            return static_cast<T*>(detail::ThreadBlockCache::Allocate(n * sizeof(T)));
+        }
+
+        void deallocate(T* ptr, size_t n) noexcept {
+            detail::ThreadBlockCache::Deallocate(ptr, n * sizeof(T));
+        }
+
+        template <typename U>
+        bool operator==(const RecyclingAllocator<U>&) const noexcept {
+            return true;
+        }
+    };
+
+} // namespace util
@@ -1,6 +1,14 @@
 #include "request_handler.h"
+#include "http_date.h"
+#include "logger.h"
+#include "prometheus_writer.h"
+#include <boost/asio/post.hpp>
 #include <boost/beast/http.hpp>
 #include <boost/json.hpp>
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <chrono>
 #include <fstream>
 #include <sstream>
 #include <stdexcept>
@@ -12,248 +20,624 @@ namespace http_handler {
     using namespace std::literals;
     namespace fs = std::filesystem;
 
-    RequestHandler::RequestHandler(model::Game& game, const fs::path& static_path,
-        net::strand<net::io_context::executor_type> strand)
+    RequestHandler::RequestHandler(model::Game& game, const StaticCache& static_cache,
+        const MapStrands& map_strands, const RequestMetrics& metrics, const MetricsExporter& exporter,
+        bool remote_admin)
         : game_(game)
-        , static_path_(static_path)
-        , strand_(strand) {
+        , static_cache_(static_cache)
+        , map_strands_(map_strands)
+        , metrics_(metrics)
+        , exporter_(exporter)
+        , map_cache_(map_strands.Size())
+        , remote_admin_(remote_admin) {
+        const auto epoch = std::chrono::system_clock::now().time_since_epoch();
+        etag_epoch_ = std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(epoch).count());
+        // Потоки ещё не запущены, strand'ы карт не нужны
+        for (size_t i = 0; i < map_cache_.size(); ++i) {
+            map_cache_[i].wait_timer = std::make_unique<net::steady_timer>(map_strands[i]);
+            PublishSnapshot(i);
+        }
     }
 
-    StringResponse RequestHandler::HandleApiRequest(StringRequest&& req) {
-        if (req.target() == "/api/v1/game/join" && req.method() == http::verb::post) {
-            return HandleJoinGame(std::move(req));
+    void RequestHandler::HandleApiRequest(StringRequest&& req, Sender&& send) {
+        const auto route = FindApiRoute(SplitTarget({ req.target().data(), req.target().size() }).first);
+        send.SetRoute(route ? static_cast<unsigned>(route->endpoint) : RequestMetrics::OTHER_ROUTE);
+        if (!route) {
+            return send(MakeErrorResponse(http::status::bad_request,
+                "badRequest",
+                "Bad request", req));
+        }
+        if (!route->Allows(req.method())) {
+            return send(MakeErrorResponse(http::status::method_not_allowed,
+                "invalidMethod",
+                "Invalid method", req, route->Allow()));
+        }
+
+        switch (route->endpoint) {
+        case ApiEndpoint::JOIN:
+            return HandleJoinGame(std::move(req), std::move(send));
+        case ApiEndpoint::PLAYERS:
+            return ReadPlayerMap(req, send, &RequestHandler::HandleGetPlayers);
+        case ApiEndpoint::STATE:
+            return ReadPlayerMap(req, send, &RequestHandler::HandleGetGameState);
+        case ApiEndpoint::STATE_WAIT:
+            return HandleWaitGameState(std::move(req), std::move(send));
+        case ApiEndpoint::PLAYER_ACTION:
+            if (req.find(http::field::content_type) == req.end() ||
+                req[http::field::content_type] != "application/json") {
+                return send(MakeErrorResponse(http::status::bad_request,
+                    "invalidArgument",
+                    "Invalid content type", req));
+            }
+            return DispatchToPlayerMap(std::move(req), std::move(send), &RequestHandler::HandlePlayerAction);
+        case ApiEndpoint::TICK:
+            return HandleTick(std::move(req), std::move(send));
+        case ApiEndpoint::LATENCY: {
+            if (!IsAdminAllowed(send)) {
+                return send(MakeErrorResponse(http::status::forbidden,
+                    "forbidden", "Admin endpoints are available only from localhost", req));
+            }
+            auto resp = MakeStringResponse(http::status::ok, metrics_.ToJson(), req);
+            resp.set(http::field::cache_control, "no-cache");
+            return send(std::move(resp));
+        }
         }
-        if (req.target() == "/api/v1/game/players" &&
-            (req.method() == http::verb::get || req.method() == http::verb::head)) {
-            return HandleGetPlayers(std::move(req));
+    }
+
+    bool RequestHandler::IsAdminAllowed(const Sender& send) const noexcept {
+        return remote_admin_ || send.IsLoopback();
+    }
+
+    std::optional<model::Dog> RequestHandler::ResolveDog(const StringRequest& req, const Sender& send) const {
+        auto token = ExtractToken(req);
+        if (!token) {
+            send(MakeErrorResponse(http::status::unauthorized,
+                "invalidToken",
+                "Authorization header is missing or malformed", req));
+            return std::nullopt;
         }
-        if (req.target() == "/api/v1/game/state" &&
-            (req.method() == http::verb::get || req.method() == http::verb::head)) {
-            return HandleGetGameState(std::move(req));
+        auto dog = game_.FindDogByToken(*token);
+        if (!dog) {
+            send(MakeErrorResponse(http::status::unauthorized,
+                "unknownToken",
+                "Player token has not been found", req));
         }
-        if (req.target() == "/api/v1/game/player/action" && req.method() == http::verb::post) {
-            return HandlePlayerAction(std::move(req));
+        return dog;
+    }
+
+    void RequestHandler::DispatchToPlayerMap(StringRequest&& req, Sender&& send, PlayerHandler handler) {
+        auto dog = ResolveDog(req, send);
+        if (!dog) {
+            return;
         }
-        if (req.target() == "/api/v1/game/tick" && req.method() == http::verb::post) {
-            return HandleTick(std::move(req));
+
+        map_strands_.Dispatch(dog->GetMapIndex(),
+            [this, handler, dog = *dog, req = std::move(req), send = std::move(send),
+            queued = std::chrono::steady_clock::now()]() mutable {
+                send.SetQueueTime(std::chrono::steady_clock::now() - queued);
+                auto response = (this->*handler)(req, dog);
+                auto& map_cache = map_cache_[dog.GetMapIndex()];
+                if (!map_cache.snapshot_dirty) {
+                    return send(std::move(response));
+                }
+                map_cache.unpublished_responses.emplace_back(std::move(send), std::move(response));
+                SchedulePublish(dog.GetMapIndex());
+            });
+    }
+
+    void RequestHandler::ReadPlayerMap(const StringRequest& req, const Sender& send, SnapshotHandler handler) const {
+        auto dog = ResolveDog(req, send);
+        if (!dog) {
+            return;
         }
-        return MakeErrorResponse(http::status::bad_request,
-            "badRequest",
-            "Bad request", req);
+        send((this->*handler)(req, GetSnapshot(dog->GetMapIndex())));
     }
 
-    StringResponse RequestHandler::HandleJoinGame(StringRequest&& req) {
+    void RequestHandler::HandleJoinGame(StringRequest&& req, Sender&& send) {
         if (req.find(http::field::content_type) == req.end() ||
             req[http::field::content_type] != "application/json") {
-            return MakeErrorResponse(http::status::bad_request,
+            return send(MakeErrorResponse(http::status::bad_request,
                 "invalidArgument",
-                "Invalid content type", req);
+                "Invalid content type", req));
         }
 
+        std::string user_name;
+        model::Map::Id map_id{ "" };
         try {
             auto json_body = json::parse(req.body());
-            auto user_name = json_body.at("userName").as_string();
-            auto map_id = json_body.at("mapId").as_string();
+            user_name = std::string(json_body.at("userName").as_string());
+            map_id = model::Map::Id{ std::string(json_body.at("mapId").as_string()) };
+        }
+        catch (const std::exception& e) {
+            return send(MakeErrorResponse(http::status::bad_request,
+                "invalidArgument",
+                "Join game request parse error", req));
+        }
 
-            if (user_name.empty()) {
-                return MakeErrorResponse(http::status::bad_request,
-                    "invalidArgument",
-                    "Invalid name", req);
-            }
+        if (user_name.empty()) {
+            return send(MakeErrorResponse(http::status::bad_request,
+                "invalidArgument",
+                "Invalid name", req));
+        }
 
-            if (auto player = game_.JoinGame(std::string(user_name), model::Map::Id{ std::string(map_id) })) {
-                json::object response;
-                response["authToken"] = player->GetToken().GetUnderlying();
-                response["playerId"] = player->GetId();
+        const auto map_index = game_.FindMapIndex(map_id);
+        if (!map_index) {
+            return send(MakeErrorResponse(http::status::not_found,
+                "mapNotFound",
+                "Map not found", req));
+        }
 
-                auto resp = MakeStringResponse(http::status::ok,
-                    json::serialize(json::value(response)), req, "application/json");
-                resp.set(http::field::cache_control, "no-cache");
-                return resp;
-            }
+        // Новая собака добавляется в DogStore карты, поэтому вход выполняется на её strand'е
+        map_strands_.Dispatch(*map_index,
+            [this, map_index = *map_index, user_name = std::move(user_name), map_id = std::move(map_id),
+            req = std::move(req), send = std::move(send), queued = std::chrono::steady_clock::now()] {
+                send.SetQueueTime(std::chrono::steady_clock::now() - queued);
+                // Исключение из обработчика strand'а завершило бы io_context::run и весь сервер
+                try {
+                    auto player = game_.JoinGame(user_name, map_id);
+                    PublishSnapshot(map_index);
 
-            return MakeErrorResponse(http::status::not_found,
-                "mapNotFound",
-                "Map not found", req);
+                    json::object response;
+                    const auto token = player->GetToken().ToHex();
+                    response["authToken"] = std::string_view{ token.data(), token.size() };
+                    response["playerId"] = player->GetId().GetValue();
 
-        }
-        catch (const std::exception& e) {
+                    auto resp = MakeStringResponse(http::status::ok,
+                        json::serialize(json::value(response)), req, "application/json");
+                    resp.set(http::field::cache_control, "no-cache");
+                    send(std::move(resp));
+                }
+                catch (const std::exception& e) {
+                    logger::Logger::GetInstance().Log("error", {
+                        { "where", "join" },
+                        { "text", e.what() } });
+                    send(MakeErrorResponse(http::status::internal_server_error,
+                        "internalError", "Failed to join the game", req));
+                }
+            });
+    }
+
+    Response RequestHandler::HandleGetPlayers(const StringRequest& req, const SnapshotPtr& snapshot) const {
+        return MakeCachedResponse(RenderPlayers(snapshot), req);
+    }
+
+    Response RequestHandler::HandleGetGameState(const StringRequest& req, const SnapshotPtr& snapshot) const {
+        std::optional<uint64_t> since;
+        if (!ParseSince(req, since)) {
             return MakeErrorResponse(http::status::bad_request,
-                "invalidArgument",
-                "Join game request parse error", req);
+                "invalidArgument", "Invalid since parameter", req);
         }
+        return MakeCachedResponse(RenderState(snapshot, since, req), req);
     }
 
-    StringResponse RequestHandler::HandleGetPlayers(StringRequest&& req) {
-        if (auto token = ExtractToken(req)) {
-            if (auto player = game_.FindPlayerByToken(*token)) {
-                json::object players;
-                for (const auto& p : game_.GetPlayers()) {
-                    if (p->GetDog().GetMap()->GetId() == player->GetDog().GetMap()->GetId()) {
-                        json::object player_info;
-                        player_info["name"] = p->GetName();
-                        players[std::to_string(p->GetId())] = player_info;
-                    }
+    void RequestHandler::HandleWaitGameState(StringRequest&& req, Sender&& send) {
+        std::optional<uint64_t> since;
+        if (!ParseSince(req, since)) {
+            return send(MakeErrorResponse(http::status::bad_request,
+                "invalidArgument", "Invalid since parameter", req));
+        }
+
+        auto dog = ResolveDog(req, send);
+        if (!dog) {
+            return;
+        }
+
+        const auto map_index = dog->GetMapIndex();
+        map_strands_.Dispatch(map_index,
+            [this, map_index, since, req = std::move(req), send = std::move(send),
+            queued = std::chrono::steady_clock::now()]() mutable {
+                const auto now = std::chrono::steady_clock::now();
+                send.SetQueueTime(now - queued);
+                auto& waiters = map_cache_[map_index].state_waiters;
+                if (waiters.size() >= MAX_STATE_WAITERS) {
+                    std::erase_if(waiters, [](const StateWaiter& waiter) { return waiter.send.IsAborted(); });
                 }
-                auto resp = MakeStringResponse(http::status::ok,
-                    json::serialize(players), req, "application/json");
-                resp.set(http::field::cache_control, "no-cache");
-                return resp;
+                if (waiters.size() >= MAX_STATE_WAITERS) {
+                    auto response = MakeErrorResponse(http::status::service_unavailable,
+                        "tooManyWaiters", "Too many requests are waiting for the map state", req);
+                    response.set(http::field::retry_after, "1");
+                    return send(std::move(response));
+                }
+                waiters.push_back({ std::move(req), std::move(send), since, now + STATE_WAIT_TIMEOUT });
+                ArmWaitTimer(map_index);
+            });
+    }
+
+    void RequestHandler::PublishSnapshot(size_t map_index) {
+        auto& map_cache = map_cache_[map_index];
+        const auto& store = game_.GetDogStore(map_index);
+        const auto current = map_cache.snapshot.load(std::memory_order_relaxed);
+
+        std::shared_ptr<MapSnapshot> next = std::move(map_cache.spare);
+        if (next && next.use_count() == 1) {
+            // Последний читатель отпустил снимок (release при уменьшении счётчика ссылок)
+            std::atomic_thread_fence(std::memory_order_acquire);
+            next->dogs.clear();
+            next->state.Reset();
+            next->delta.Reset();
+            next->frame.Reset();
+            next->frame_delta.Reset();
+        }
+        else {
+            next = std::make_shared<MapSnapshot>();
+        }
+
+        next->map_index = map_index;
+        next->version = store.GetVersion();
+        next->previous = current ? current->version : 0;
+
+        const auto roster_version = store.GetRosterVersion();
+        std::shared_ptr<RosterSnapshot> roster;
+        if (current && current->roster->version == roster_version) {
+            next->roster = current->roster;
+        }
+        else {
+            roster = std::make_shared<RosterSnapshot>();
+            roster->version = roster_version;
+        }
+
+        game_.ForEachPlayerOnMap(map_index, [&next, &roster, &store](const model::Player& p) {
+            const auto& dog = p.GetDog();
+            next->dogs.push_back({ p.GetId().GetValue(), dog.GetPosition(), dog.GetSpeed(),
+                static_cast<char>(dog.GetDirection()), store.GetChangedAt(dog.GetSlot()) });
+            if (roster) {
+                roster->players.emplace_back(p.GetId().GetValue(), p.GetName());
             }
-            return MakeErrorResponse(http::status::unauthorized,
-                "unknownToken",
-                "Player token has not been found", req);
+        });
+        if (roster) {
+            next->roster = std::move(roster);
         }
-        return MakeErrorResponse(http::status::unauthorized,
-            "invalidToken",
-            "Authorization header is missing", req);
-    }
 
-    StringResponse RequestHandler::HandleGetGameState(StringRequest&& req) {
-        if (auto token = ExtractToken(req)) {
-            if (auto player = game_.FindPlayerByToken(*token)) {
-                json::object players;
-                for (const auto& p : game_.GetPlayers()) {
-                    if (p->GetDog().GetMap()->GetId() == player->GetDog().GetMap()->GetId()) {
-                        auto pos = p->GetDog().GetPosition();
-                        auto speed = p->GetDog().GetSpeed();
+        auto previous = map_cache.snapshot.exchange(std::move(next), std::memory_order_acq_rel);
+        map_cache.spare = std::const_pointer_cast<MapSnapshot>(std::move(previous));
 
-                        json::array pos_arr = { pos[0], pos[1] };
-                        json::array speed_arr = { speed[0], speed[1] };
+        map_cache.snapshot_dirty = false;
+        for (auto& [send, response] : map_cache.unpublished_responses) {
+            send(std::move(response));
+        }
+        map_cache.unpublished_responses.clear();
+    }
 
-                        json::object player_info;
-                        player_info["pos"] = pos_arr;
-                        player_info["speed"] = speed_arr;
-                        player_info["dir"] = std::string(1, static_cast<char>(p->GetDog().GetDirection()));
+    void RequestHandler::SchedulePublish(size_t map_index) {
+        auto& map_cache = map_cache_[map_index];
+        if (map_cache.publish_scheduled) {
+            return;
+        }
+        map_cache.publish_scheduled = true;
+        // post, а не dispatch: публикация встаёт за действиями, уже ждущими в очереди strand'а
+        net::post(map_strands_[map_index], [this, map_index] {
+            auto& map_cache = map_cache_[map_index];
+            map_cache.publish_scheduled = false;
+            // Тик или вход игрока могли уже опубликовать эти изменения
+            if (map_cache.snapshot_dirty) {
+                PublishSnapshot(map_index);
+            }
+        });
+    }
 
-                        players[std::to_string(p->GetId())] = player_info;
-                    }
-                }
+    RequestHandler::SnapshotPtr RequestHandler::GetSnapshot(size_t map_index) const {
+        return map_cache_[map_index].snapshot.load(std::memory_order_acquire);
+    }
 
-                json::object result;
-                result["players"] = players;
+    std::shared_ptr<const RequestHandler::RenderCache> RequestHandler::RenderPlayers(const SnapshotPtr& snapshot) const {
+        const auto& roster = *snapshot->roster;
+        // Снимок держит roster, поэтому указатель на отрисовку можно привязать к снимку
+        return { snapshot, &roster.render.Get([this, &roster, map_index = snapshot->map_index](RenderCache& cache) {
+            util::JsonWriter writer{ cache.body };
+            writer.BeginObject();
+            for (const auto& [id, name] : roster.players) {
+                writer.Key(id).BeginObject()
+                    .Key("name").Value(name)
+                    .EndObject();
+            }
+            writer.EndObject();
+            cache.version = roster.version;
+            UpdateETag(cache, map_index, 'p');
+        }) };
+    }
 
-                auto resp = MakeStringResponse(http::status::ok,
-                    json::serialize(result), req);
-                resp.set(http::field::cache_control, "no-cache");
-                return resp;
+    // Все игроки карты, опрашивающие состояние в пределах одного тика, получают одну сериализацию
+    std::shared_ptr<const RequestHandler::RenderCache> RequestHandler::RenderState(const SnapshotPtr& snapshot,
+        std::optional<uint64_t> since, const StringRequest& req) const {
+        const auto& snap = *snapshot;
+        // Версия из будущего (например, после перезапуска сервера): отдаём всё состояние
+        if (since && *since > snap.version) {
+            since = 0;
+        }
+
+        if (AcceptsStateFrame(req)) {
+            const auto frame_since = since.value_or(0);
+            if (frame_since == 0) {
+                return { snapshot, &snap.frame.Get([this, &snap](RenderCache& cache) {
+                    RenderStateFrame(snap, 0, cache);
+                }) };
+            }
+            if (frame_since == snap.previous) {
+                return { snapshot, &snap.frame_delta.Get([this, &snap](RenderCache& cache) {
+                    RenderStateFrame(snap, snap.previous, cache);
+                }) };
             }
-            return MakeErrorResponse(http::status::unauthorized,
-                "unknownToken", "Player token has not been found", req);
+            auto cache = std::make_shared<RenderCache>();
+            RenderStateFrame(snap, frame_since, *cache);
+            return cache;
         }
-        return MakeErrorResponse(http::status::unauthorized,
-            "invalidToken", "Authorization header is missing", req);
+
+        if (!since) {
+            return { snapshot, &snap.state.Get([this, &snap](RenderCache& cache) {
+                RenderStateJson(snap, std::nullopt, cache);
+            }) };
+        }
+        if (*since == snap.previous) {
+            return { snapshot, &snap.delta.Get([this, &snap](RenderCache& cache) {
+                RenderStateJson(snap, snap.previous, cache);
+            }) };
+        }
+        auto cache = std::make_shared<RenderCache>();
+        RenderStateJson(snap, since, *cache);
+        return cache;
     }
 
-    StringResponse RequestHandler::HandlePlayerAction(StringRequest&& req) {
-        if (req.method() != http::verb::post) {
-            auto response = MakeErrorResponse(http::status::method_not_allowed,
-                "invalidMethod", "Only POST method is allowed", req);
-            response.set(http::field::allow, "POST");
-            return response;
+    void RequestHandler::RenderStateJson(const MapSnapshot& snapshot, std::optional<uint64_t> since,
+        RenderCache& cache) const {
+        const auto changed_after = since.value_or(0);
+        cache.body.clear();
+        util::JsonWriter writer{ cache.body };
+        writer.BeginObject();
+        if (since) {
+            writer.Key("tick").Value(snapshot.version);
         }
+        writer.Key("players").BeginObject();
+        for (const auto& dog : snapshot.dogs) {
+            if (dog.changed_at <= changed_after) {
+                continue;
+            }
+            writer.Key(dog.player_id).BeginObject()
+                .Key("pos").BeginArray().Value(dog.pos[0]).Value(dog.pos[1]).EndArray()
+                .Key("speed").BeginArray().Value(dog.speed[0]).Value(dog.speed[1]).EndArray()
+                .Key("dir").Value(std::string_view{ &dog.dir, 1 })
+                .EndObject();
+        }
+        writer.EndObject().EndObject();
+        cache.version = snapshot.version;
+        cache.since = changed_after;
+        UpdateETag(cache, snapshot.map_index, since ? 'd' : 's');
+    }
 
-        if (req.find(http::field::content_type) == req.end() ||
-            req[http::field::content_type] != "application/json") {
-            return MakeErrorResponse(http::status::bad_request,
-                "invalidArgument",
-                "Invalid content type", req);
+    void RequestHandler::RenderStateFrame(const MapSnapshot& snapshot, uint64_t since, RenderCache& cache) const {
+        cache.body.clear();
+        util::StateFrameWriter frame{ cache.body, snapshot.version };
+        for (const auto& dog : snapshot.dogs) {
+            if (dog.changed_at > since) {
+                frame.Add(dog.player_id, dog.pos, dog.speed, dog.dir);
+            }
         }
+        frame.Finish();
+        cache.version = snapshot.version;
+        cache.since = since;
+        cache.content_type = util::StateFrameWriter::CONTENT_TYPE;
+        UpdateETag(cache, snapshot.map_index, 'b');
+    }
 
-        if (auto token = ExtractToken(req)) {
-            if (auto player = game_.FindPlayerByToken(*token)) {
-                try {
-                    auto json_body = json::parse(req.body());
-                    auto move = json_body.at("move").as_string();
+    void RequestHandler::Tick(std::chrono::milliseconds delta, std::function<void()> done) {
+        map_strands_.ForEach(
+            [this, delta](size_t map_index) {
+                game_.UpdateMapState(map_index, static_cast<int>(delta.count()));
+                PublishSnapshot(map_index);
+                WakeStateWaiters(map_index);
+            },
+            std::move(done));
+    }
 
-                    auto& dog = player->GetDog();
-                    double speed = dog.GetMap()->GetDogSpeed();
+    void RequestHandler::WakeStateWaiters(size_t map_index) {
+        auto& waiters = map_cache_[map_index].state_waiters;
+        if (waiters.empty()) {
+            return;
+        }
 
-                    if (move == "L") {
-                        dog.SetDirection(model::Dog::Direction::WEST);
-                        dog.SetSpeed(-speed, 0);
-                    }
-                    else if (move == "R") {
-                        dog.SetDirection(model::Dog::Direction::EAST);
-                        dog.SetSpeed(speed, 0);
-                    }
-                    else if (move == "U") {
-                        dog.SetDirection(model::Dog::Direction::NORTH);
-                        dog.SetSpeed(0, -speed);
-                    }
-                    else if (move == "D") {
-                        dog.SetDirection(model::Dog::Direction::SOUTH);
-                        dog.SetSpeed(0, speed);
-                    }
-                    else if (move == "") {
-                        dog.SetSpeed(0, 0);
-                    }
-                    else {
-                        return MakeErrorResponse(http::status::bad_request,
-                            "invalidArgument", "Invalid move value", req);
-                    }
+        // Ожидающие с одинаковым since получают одну сериализацию снимка
+        const auto snapshot = GetSnapshot(map_index);
+        for (auto& waiter : waiters) {
+            if (!waiter.send.IsAborted()) {
+                waiter.send(MakeCachedResponse(RenderState(snapshot, waiter.since, waiter.req), waiter.req));
+            }
+        }
+        waiters.clear();
+    }
 
-                    return MakeStringResponse(http::status::ok, "{}", req, "application/json");
-                }
-                catch (const std::exception& e) {
-                    return MakeErrorResponse(http::status::bad_request,
-                        "invalidArgument", "Failed to parse action", req);
-                }
+    void RequestHandler::ExpireStateWaiters(size_t map_index) {
+        auto& waiters = map_cache_[map_index].state_waiters;
+        const auto now = std::chrono::steady_clock::now();
+        SnapshotPtr snapshot;
+        std::erase_if(waiters, [&](StateWaiter& waiter) {
+            if (waiter.send.IsAborted()) {
+                return true;
+            }
+            if (waiter.deadline > now) {
+                return false;
             }
-            return MakeErrorResponse(http::status::unauthorized,
-                "unknownToken", "Player token has not been found", req);
+            // Тика не дождались: клиент получает текущее состояние или 304, если оно у него уже есть
+            if (!snapshot) {
+                snapshot = GetSnapshot(map_index);
+            }
+            waiter.send(MakeCachedResponse(RenderState(snapshot, waiter.since, waiter.req), waiter.req));
+            return true;
+        });
+        ArmWaitTimer(map_index);
+    }
+
+    void RequestHandler::ArmWaitTimer(size_t map_index) {
+        auto& map_cache = map_cache_[map_index];
+        if (map_cache.wait_timer_armed || map_cache.state_waiters.empty()) {
+            return;
         }
-        return MakeErrorResponse(http::status::unauthorized,
-            "invalidToken", "Authorization header is missing", req);
+        map_cache.wait_timer_armed = true;
+        map_cache.wait_timer->expires_at(map_cache.state_waiters.front().deadline);
+        map_cache.wait_timer->async_wait([this, map_index](beast::error_code ec) {
+            map_cache_[map_index].wait_timer_armed = false;
+            if (!ec) {
+                ExpireStateWaiters(map_index);
+            }
+        });
     }
 
-    StringResponse RequestHandler::HandleTick(StringRequest&& req) {
-        if (tick_period_.has_value()) {
-            return MakeErrorResponse(http::status::bad_request,
-                "badRequest",
-                "Manual tick is disabled in auto-tick mode", req);
+    void RequestHandler::UpdateETag(RenderCache& cache, size_t map_index, char kind) const {
+        cache.etag.clear();
+        cache.etag += '"';
+        cache.etag += etag_epoch_;
+        cache.etag += '-';
+        cache.etag += kind;
+        cache.etag += std::to_string(map_index);
+        cache.etag += '-';
+        if (kind == 'd' || kind == 'b') {
+            cache.etag += std::to_string(cache.since);
+            cache.etag += '-';
         }
+        cache.etag += std::to_string(*cache.version);
+        cache.etag += '"';
+    }
 
-        if (req.method() != http::verb::post) {
-            auto response = MakeErrorResponse(http::status::method_not_allowed,
-                "invalidMethod", "Only POST method is allowed", req);
-            response.set(http::field::allow, "POST");
-            return response;
+    bool RequestHandler::MatchesETag(const StringRequest& req, std::string_view etag) {
+        auto it = req.find(http::field::if_none_match);
+        if (it == req.end()) {
+            return false;
         }
 
-        if (req.find(http::field::content_type) == req.end() ||
-            req[http::field::content_type] != "application/json") {
-            return MakeErrorResponse(http::status::bad_request,
-                "invalidArgument",
-                "Invalid content type", req);
+        std::string_view candidates{ it->value().data(), it->value().size() };
+        while (!candidates.empty()) {
+            const auto comma = candidates.find(',');
+            auto tag = candidates.substr(0, comma);
+            candidates = comma == std::string_view::npos ? std::string_view{} : candidates.substr(comma + 1);
+
+            while (!tag.empty() && tag.front() == ' ') {
+                tag.remove_prefix(1);
+            }
+            while (!tag.empty() && tag.back() == ' ') {
+                tag.remove_suffix(1);
+            }
+            if (tag.starts_with("W/")) {
+                tag.remove_prefix(2);
+            }
+
+            if (tag == "*" || tag == etag) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Тело не копируется: ответ ссылается на общую сериализацию, как файлы из кэша статики
+    Response RequestHandler::MakeCachedResponse(std::shared_ptr<const RenderCache> cache,
+        const StringRequest& req) const {
+        // 304 несёт те же заголовки кэширования, что и 200: по Vary кэш отличает JSON от бинарного кадра
+        const auto set_cache_headers = [&cache, &req](auto& response) {
+            response.set(http::field::etag, cache->etag);
+            response.set(http::field::vary, "Accept");
+            response.set(http::field::cache_control, "no-cache");
+            response.keep_alive(req.keep_alive());
+        };
+        if (MatchesETag(req, cache->etag)) {
+            StringResponse response(http::status::not_modified, req.version());
+            set_cache_headers(response);
+            return response;
         }
 
+        // На HEAD тело не отправляется, но Content-Length остаётся размером представления
+        const std::string_view body = cache->body;
+        const bool head = req.method() == http::verb::head;
+        BufferResponse resp{ http::status::ok, req.version() };
+        resp.set(http::field::content_type,
+            beast::string_view(cache->content_type.data(), cache->content_type.size()));
+        set_cache_headers(resp);
+        resp.content_length(body.size());
+        resp.body() = { std::move(cache), head ? std::string_view{} : body };
+        return resp;
+    }
+
+    StringResponse RequestHandler::HandlePlayerAction(const StringRequest& req, model::Dog dog) {
         try {
             auto json_body = json::parse(req.body());
-            auto time_delta = json_body.at("timeDelta").as_int64();
+            auto move = json_body.at("move").as_string();
+
+            double speed = dog.GetMap()->GetDogSpeed();
 
-            if (time_delta <= 0) {
+            if (move == "L") {
+                dog.SetDirection(model::Dog::Direction::WEST);
+                dog.SetSpeed(-speed, 0);
+            }
+            else if (move == "R") {
+                dog.SetDirection(model::Dog::Direction::EAST);
+                dog.SetSpeed(speed, 0);
+            }
+            else if (move == "U") {
+                dog.SetDirection(model::Dog::Direction::NORTH);
+                dog.SetSpeed(0, -speed);
+            }
+            else if (move == "D") {
+                dog.SetDirection(model::Dog::Direction::SOUTH);
+                dog.SetSpeed(0, speed);
+            }
+            else if (move == "") {
+                dog.SetSpeed(0, 0);
+            }
+            else {
                 return MakeErrorResponse(http::status::bad_request,
-                    "invalidArgument", "timeDelta must be positive", req);
+                    "invalidArgument", "Invalid move value", req);
             }
+            // Снимок строится за O(игроков карты), поэтому публикуется один раз на очередь действий
+            map_cache_[dog.GetMapIndex()].snapshot_dirty = true;
 
-            game_.UpdateState(static_cast<int>(time_delta));
-
-            auto resp = MakeStringResponse(http::status::ok, "{}", req, "application/json");
-            resp.set(http::field::cache_control, "no-cache");
-            return resp;
+            return MakeStringResponse(http::status::ok, "{}", req, "application/json");
         }
         catch (const std::exception& e) {
             return MakeErrorResponse(http::status::bad_request,
-                "invalidArgument", "Failed to parse tick request JSON", req);
+                "invalidArgument", "Failed to parse action", req);
         }
     }
 
+    void RequestHandler::HandleTick(StringRequest&& req, Sender&& send) {
+        if (tick_period_.has_value()) {
+            return send(MakeErrorResponse(http::status::bad_request,
+                "badRequest",
+                "Manual tick is disabled in auto-tick mode", req));
+        }
+
+        if (req.find(http::field::content_type) == req.end() ||
+            req[http::field::content_type] != "application/json") {
+            return send(MakeErrorResponse(http::status::bad_request,
+                "invalidArgument",
+                "Invalid content type", req));
+        }
+
+        int64_t time_delta = 0;
+        try {
+            auto json_body = json::parse(req.body());
+            time_delta = json_body.at("timeDelta").as_int64();
+        }
+        catch (const std::exception& e) {
+            return send(MakeErrorResponse(http::status::bad_request,
+                "invalidArgument", "Failed to parse tick request JSON", req));
+        }
+
+        if (time_delta <= 0) {
+            return send(MakeErrorResponse(http::status::bad_request,
+                "invalidArgument", "timeDelta must be positive", req));
+        }
+
+        // Ответ отправляется, когда тик применён ко всем картам
+        auto resp = MakeStringResponse(http::status::ok, "{}", req, "application/json");
+        resp.set(http::field::cache_control, "no-cache");
+        Tick(std::chrono::milliseconds{ time_delta },
+            [resp = std::move(resp), send = std::move(send)]() mutable {
+                send(std::move(resp));
+            });
+    }
+
     std::optional<model::Token> RequestHandler::ExtractToken(const StringRequest& req) const {
         if (auto it = req.find(http::field::authorization); it != req.end()) {
-            auto auth = it->value();
-            if (auth.starts_with("Bearer ")) {
-                return model::Token{ std::string(auth.substr(7)) };
+            const std::string_view auth{ it->value().data(), it->value().size() };
+            constexpr std::string_view BEARER = "Bearer ";
+            if (auth.starts_with(BEARER)) {
+                return model::Token::Parse(auth.substr(BEARER.size()));
             }
         }
         return std::nullopt;
@@ -271,7 +655,7 @@ namespace http_handler {
     }
 
     StringResponse RequestHandler::MakeErrorResponse(http::status status, std::string_view code,
-        std::string_view message, const StringRequest& req) {
+        std::string_view message, const StringRequest& req, std::string_view allow) {
         json::object json_res;
         json_res["code"] = std::string(code);
         json_res["message"] = std::string(message);
@@ -279,18 +663,39 @@ namespace http_handler {
         auto response = MakeStringResponse(status, json::serialize(json_res), req);
         response.set(http::field::cache_control, "no-cache");
 
-        if (status == http::status::method_not_allowed) {
-            if (req.target() == "/api/v1/game/join") {
-                response.set(http::field::allow, "POST");
-            }
-            else if (req.target() == "/api/v1/game/players" || req.target() == "/api/v1/game/state") {
-                response.set(http::field::allow, "GET, HEAD");
+        if (!allow.empty()) {
+            response.set(http::field::allow, beast::string_view(allow.data(), allow.size()));
+        }
+        return response;
+    }
+
+    std::pair<std::string_view, std::string_view> RequestHandler::SplitTarget(std::string_view target) {
+        const auto pos = target.find('?');
+        if (pos == std::string_view::npos) {
+            return { target, {} };
+        }
+        return { target.substr(0, pos), target.substr(pos + 1) };
+    }
+
+    bool RequestHandler::ParseSince(const StringRequest& req, std::optional<uint64_t>& since) {
+        auto query = SplitTarget({ req.target().data(), req.target().size() }).second;
+        while (!query.empty()) {
+            const auto amp = query.find('&');
+            const auto param = query.substr(0, amp);
+            query = amp == std::string_view::npos ? std::string_view{} : query.substr(amp + 1);
+
+            if (!param.starts_with("since=")) {
+                continue;
             }
-            else if (req.target() == "/api/v1/game/player/action" || req.target() == "/api/v1/game/tick") {
-                response.set(http::field::allow, "POST");
+            const auto value = param.substr(6);
+            uint64_t parsed = 0;
+            auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), parsed);
+            if (ec != std::errc{} || ptr != value.data() + value.size()) {
+                return false;
             }
+            since = parsed;
         }
-        return response;
+        return true;
     }
 
     std::string RequestHandler::DecodeUrl(std::string_view url) {
@@ -318,86 +723,304 @@ namespace http_handler {
         return decoded.str();
     }
 
-    std::string RequestHandler::GetMimeType(std::string_view path) {
-        static const std::unordered_map<std::string_view, std::string_view> mime_types = {
-            {".htm", "text/html"},
-            {".html", "text/html"},
-            {".css", "text/css"},
-            {".txt", "text/plain"},
-            {".js", "text/javascript"},
-            {".json", "application/json"},
-            {".xml", "application/xml"},
-            {".png", "image/png"},
-            {".jpg", "image/jpeg"},
-            {".jpe", "image/jpeg"},
-            {".jpeg", "image/jpeg"},
-            {".gif", "image/gif"},
-            {".bmp", "image/bmp"},
-            {".ico", "image/vnd.microsoft.icon"},
-            {".tiff", "image/tiff"},
-            {".tif", "image/tiff"},
-            {".svg", "image/svg+xml"},
-            {".svgz", "image/svg+xml"},
-            {".mp3", "audio/mpeg"}
+    bool RequestHandler::IsNotModified(const StringRequest& req, std::string_view etag,
+        std::chrono::sys_seconds last_modified) {
+        // If-None-Match важнее If-Modified-Since (RFC 7232, раздел 6)
+        if (req.find(http::field::if_none_match) != req.end()) {
+            return MatchesETag(req, etag);
+        }
+        if (auto it = req.find(http::field::if_modified_since); it != req.end()) {
+            const auto since = util::ParseHttpDate({ it->value().data(), it->value().size() });
+            return since && last_modified <= *since;
+        }
+        return false;
+    }
+
+    bool RequestHandler::ParseRange(const StringRequest& req, std::string_view etag, uint64_t size,
+        std::optional<ByteRange>& range) {
+        auto it = req.find(http::field::range);
+        if (it == req.end()) {
+            return true;
+        }
+        // If-Range с другим ETag: файл изменился, отдаём его целиком
+        if (auto if_range = req.find(http::field::if_range); if_range != req.end()
+            && std::string_view(if_range->value().data(), if_range->value().size()) != etag) {
+            return true;
+        }
+
+        std::string_view spec{ it->value().data(), it->value().size() };
+        if (!spec.starts_with("bytes=") || spec.find(',') != std::string_view::npos) {
+            return true;
+        }
+        spec.remove_prefix(6);
+        const auto dash = spec.find('-');
+        if (dash == std::string_view::npos) {
+            return true;
+        }
+
+        const auto parse = [](std::string_view text, uint64_t& value) {
+            auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+            return !text.empty() && ec == std::errc{} && ptr == text.data() + text.size();
         };
 
-        auto pos = path.rfind('.');
-        if (pos == std::string_view::npos) {
-            return "application/octet-stream";
+        uint64_t first = 0;
+        uint64_t last = 0;
+        const auto first_text = spec.substr(0, dash);
+        const auto last_text = spec.substr(dash + 1);
+        if (first_text.empty()) {
+            // bytes=-n: последние n байт
+            if (!parse(last_text, last)) {
+                return true;
+            }
+            if (last == 0 || size == 0) {
+                return false;
+            }
+            const auto length = std::min(last, size);
+            range = ByteRange{ size - length, length };
+            return true;
         }
 
-        std::string ext(path.substr(pos));
-        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) {
-            return std::tolower(c);
-            });
+        if (!parse(first_text, first)) {
+            return true;
+        }
+        if (last_text.empty()) {
+            last = size == 0 ? 0 : size - 1;
+        }
+        else if (!parse(last_text, last) || last < first) {
+            return true;
+        }
+        if (first >= size) {
+            return false;
+        }
+        last = std::min(last, size - 1);
+        range = ByteRange{ first, last - first + 1 };
+        return true;
+    }
+
+    bool RequestHandler::AcceptsGzip(const StringRequest& req) {
+        auto it = req.find(http::field::accept_encoding);
+        if (it == req.end()) {
+            return false;
+        }
+
+        std::string_view codings{ it->value().data(), it->value().size() };
+        while (!codings.empty()) {
+            const auto comma = codings.find(',');
+            auto coding = codings.substr(0, comma);
+            codings = comma == std::string_view::npos ? std::string_view{} : codings.substr(comma + 1);
+
+            const auto semicolon = coding.find(';');
+            auto name = coding.substr(0, semicolon);
+            while (!name.empty() && name.front() == ' ') {
+                name.remove_prefix(1);
+            }
+            while (!name.empty() && name.back() == ' ') {
+                name.remove_suffix(1);
+            }
+            if (name != "gzip" && name != "*") {
+                continue;
+            }
+
+            // gzip;q=0 означает явный отказ от сжатия
+            if (semicolon != std::string_view::npos) {
+                auto params = coding.substr(semicolon + 1);
+                while (!params.empty() && params.front() == ' ') {
+                    params.remove_prefix(1);
+                }
+                if (params.starts_with("q=0") && params.find_first_not_of("0.", 3) == std::string_view::npos) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        return false;
+    }
+
+    bool RequestHandler::AcceptsStateFrame(const StringRequest& req) {
+        auto it = req.find(http::field::accept);
+        if (it == req.end()) {
+            return false;
+        }
+
+        const auto trim = [](std::string_view text) {
+            while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+                text.remove_prefix(1);
+            }
+            while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) {
+                text.remove_suffix(1);
+            }
+            return text;
+        };
+        const auto iequals = [](std::string_view a, std::string_view b) {
+            return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(),
+                [](unsigned char x, unsigned char y) { return std::tolower(x) == std::tolower(y); });
+        };
+        // Вес q в тысячных: q=0.5 -> 500. Без параметра q вес 1
+        const auto quality = [&trim](std::string_view params) {
+            unsigned q = 1000;
+            while (!params.empty()) {
+                const auto semicolon = params.find(';');
+                const auto param = trim(params.substr(0, semicolon));
+                params = semicolon == std::string_view::npos ? std::string_view{} : params.substr(semicolon + 1);
+                if (param.size() < 2 || (param[0] != 'q' && param[0] != 'Q') || param[1] != '=') {
+                    continue;
+                }
+                const auto value = param.substr(2);
+                unsigned integer = 0;
+                const auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), integer);
+                if (ec != std::errc{} || integer > 1) {
+                    return 0u;
+                }
+                q = integer * 1000;
+                if (ptr != value.data() + value.size() && *ptr == '.') {
+                    unsigned scale = 100;
+                    const auto end = value.data() + value.size();
+                    for (auto digit = ptr + 1; digit != end && scale > 0 && std::isdigit(static_cast<unsigned char>(*digit));
+                        ++digit, scale /= 10) {
+                        q += static_cast<unsigned>(*digit - '0') * scale;
+                    }
+                }
+                q = std::min(q, 1000u);
+            }
+            return q;
+        };
+
+        // Берётся вес самого точного диапазона для каждого из вариантов: type/subtype, type/*, */*
+        int frame_precision = -1, json_precision = -1;
+        unsigned frame_q = 0, json_q = 0;
+        std::string_view ranges{ it->value().data(), it->value().size() };
+        while (!ranges.empty()) {
+            const auto comma = ranges.find(',');
+            const auto range = ranges.substr(0, comma);
+            ranges = comma == std::string_view::npos ? std::string_view{} : ranges.substr(comma + 1);
 
-        auto it = mime_types.find(ext);
-        if (it == mime_types.end()) {
-            return "application/octet-stream";
+            const auto semicolon = range.find(';');
+            const auto media = trim(range.substr(0, semicolon));
+            const auto q = quality(semicolon == std::string_view::npos ? std::string_view{} : range.substr(semicolon + 1));
+            const auto match = [&](std::string_view type, int& precision, unsigned& best) {
+                const int current = iequals(media, type) ? 2
+                    : iequals(media, "application/*") ? 1
+                    : media == "*/*" ? 0 : -1;
+                if (current > precision) {
+                    precision = current;
+                    best = q;
+                }
+            };
+            match(util::StateFrameWriter::CONTENT_TYPE, frame_precision, frame_q);
+            match("application/json", json_precision, json_q);
         }
-        return std::string(it->second);
+        // Кадр отдаётся только по явной просьбе: подстановки */* и application/* оставляют JSON.
+        // application/x-game-state;q=0 — явный отказ от кадра
+        return frame_precision == 2 && frame_q > 0 && (json_precision < 0 || frame_q >= json_q);
     }
 
-    bool RequestHandler::IsSubPath(const fs::path& path, const fs::path& base) {
-        auto relative = fs::relative(path, base);
-        return !relative.empty() && relative.native()[0] != '.';
+    StringResponse RequestHandler::HandleMetricsRequest(const StringRequest& req) const {
+        if (req.method() != http::verb::get && req.method() != http::verb::head) {
+            return MakeErrorResponse(http::status::method_not_allowed, "invalidMethod",
+                "Only GET and HEAD methods are expected", req, "GET, HEAD");
+        }
+        auto resp = MakeStringResponse(http::status::ok, exporter_.Export(), req,
+            util::PrometheusWriter::CONTENT_TYPE);
+        resp.set(http::field::cache_control, "no-cache");
+        return resp;
     }
 
-    StringResponse RequestHandler::HandleStaticRequest(StringRequest&& req) {
+    Response RequestHandler::HandleStaticRequest(StringRequest&& req) {
         try {
-            auto target = req.target();
-            std::string_view target_sv(target.data(), target.size());
-            auto path = DecodeUrl(target_sv);
+            auto path = DecodeUrl(SplitTarget({ req.target().data(), req.target().size() }).first);
 
             if (path.empty() || path[0] != '/') {
                 throw std::runtime_error("Invalid path");
             }
             path = path.substr(1);
 
-            auto full_path = fs::weakly_canonical(static_path_ / path);
+            auto file = static_cache_.Find(path);
+            if (!file) {
+                // Путь вида "a/../b" ищем повторно после нормализации; выход за пределы корня запрещён
+                auto normal = fs::path(path).lexically_normal().generic_string();
+                if (normal == ".." || normal.starts_with("../")) {
+                    throw std::runtime_error("Invalid path");
+                }
+                if (normal == ".") {
+                    normal.clear();
+                }
+                file = static_cache_.Find(normal);
+            }
+            if (!file) {
+                throw std::runtime_error("File not found");
+            }
 
-            if (!IsSubPath(full_path, static_path_)) {
-                throw std::runtime_error("Invalid path");
+            const bool accepts_gzip = file->gzip && AcceptsGzip(req);
+            const auto& etag = accepts_gzip ? file->gzip_etag : file->etag;
+            if (req.method() != http::verb::post && IsNotModified(req, etag, file->last_modified)) {
+                StringResponse resp{ http::status::not_modified, req.version() };
+                resp.set(http::field::etag, etag);
+                resp.set(http::field::last_modified, file->last_modified_text);
+                resp.set(http::field::cache_control, file->cache_control);
+                if (file->gzip) {
+                    resp.set(http::field::vary, "Accept-Encoding");
+                }
+                resp.keep_alive(req.keep_alive());
+                return resp;
             }
 
-            if (fs::is_directory(full_path)) {
-                full_path /= "index.html";
+            std::optional<ByteRange> range;
+            if (!ParseRange(req, file->etag, file->size, range)) {
+                auto resp = MakeStringResponse(http::status::range_not_satisfiable, {}, req, "text/plain");
+                resp.set(http::field::content_range, "bytes */" + std::to_string(file->size));
+                return resp;
             }
 
-            if (!fs::exists(full_path)) {
-                throw std::runtime_error("File not found");
+            // На HEAD тело не отправляется, но Content-Length остаётся размером представления
+            const bool head = req.method() == http::verb::head;
+            const auto prepare = [&](auto& resp, uint64_t content_length) {
+                resp.set(http::field::content_type, file->mime_type);
+                resp.set(http::field::accept_ranges, "bytes");
+                resp.set(http::field::last_modified, file->last_modified_text);
+                resp.set(http::field::cache_control, file->cache_control);
+                if (range) {
+                    resp.result(http::status::partial_content);
+                    resp.set(http::field::content_range, "bytes " + std::to_string(range->offset) + '-'
+                        + std::to_string(range->offset + range->length - 1) + '/' + std::to_string(file->size));
+                }
+                resp.content_length(content_length);
+                resp.keep_alive(req.keep_alive());
+            };
+
+            // Файлы из кэша отдаются из памяти без копирования и без обращения к файловой системе
+            if (file->content) {
+                // Диапазоны относятся к несжатому представлению
+                const bool gzip = !range && accepts_gzip;
+                std::string_view data = gzip ? *file->gzip : *file->content;
+                if (range) {
+                    data = data.substr(range->offset, range->length);
+                }
+
+                BufferResponse resp{ http::status::ok, req.version() };
+                resp.body() = { file, head ? std::string_view{} : data };
+                resp.set(http::field::etag, gzip ? file->gzip_etag : file->etag);
+                if (gzip) {
+                    resp.set(http::field::content_encoding, "gzip");
+                }
+                if (file->gzip) {
+                    resp.set(http::field::vary, "Accept-Encoding");
+                }
+                prepare(resp, data.size());
+                return resp;
             }
 
-            std::ifstream file(full_path, std::ios::binary);
-            if (!file) {
+            FileResponse resp{ http::status::ok, req.version() };
+            auto& body = resp.body();
+            beast::error_code ec;
+            body.file.open(file->path.c_str(), beast::file_mode::scan, ec);
+            if (ec) {
                 throw std::runtime_error("Failed to open file");
             }
-
-            std::string content((std::istreambuf_iterator<char>(file)),
-                std::istreambuf_iterator<char>());
-
-            auto resp = MakeStringResponse(http::status::ok, content, req, GetMimeType(full_path.string()));
-            resp.set(http::field::cache_control, "no-cache");
+            const uint64_t length = range ? range->length : file->size;
+            body.offset = range ? range->offset : 0;
+            body.length = head ? 0 : length;
+            resp.set(http::field::etag, file->etag);
+            prepare(resp, length);
             return resp;
         }
         catch (const std::exception& e) {
@@ -1,11 +1,29 @@
 #pragma once
 
+#include "api_routes.h"
 #include "game.h"
+#include "http_response.h"
+#include "map_strands.h"
+#include "metrics_exporter.h"
+#include "request_metrics.h"
+#include "json_writer.h"
+#include "state_frame.h"
+#include "static_cache.h"
 #include <filesystem>
 #include <boost/beast/http.hpp>
 #include <boost/json.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/asio/strand.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace http_handler {
 
@@ -15,64 +33,262 @@ namespace http_handler {
     namespace fs = std::filesystem;
     namespace net = boost::asio;
 
-    using StringResponse = http::response<http::string_body>;
-    using StringRequest = http::request<http::string_body>;
-    using FileResponse = http::response<http::file_body>;
+    using http_server::StringRequest;
+    using http_server::StringResponse;
+    using http_server::BufferResponse;
+    using http_server::FileResponse;
+    using http_server::Response;
 
     class RequestHandler {
     public:
-        explicit RequestHandler(model::Game& game, const fs::path& static_path,
-            net::strand<net::io_context::executor_type> strand);
+        using Sender = http_server::ResponseSender;
+
+        // remote_admin открывает служебные маршруты (/metrics, /api/v1/admin/*) клиентам с других машин.
+        // По умолчанию они отвечают только на адрес обратной петли
+        explicit RequestHandler(model::Game& game, const StaticCache& static_cache,
+            const MapStrands& map_strands, const RequestMetrics& metrics, const MetricsExporter& exporter,
+            bool remote_admin = false);
 
         RequestHandler(const RequestHandler&) = delete;
         RequestHandler& operator=(const RequestHandler&) = delete;
 
+        // Продвигает игру на delta на всех картах и будит ожидающих состояния карты.
+        // done вызывается, когда тик применён ко всем картам
+        void Tick(std::chrono::milliseconds delta, std::function<void()> done = [] {});
+
+        // Статика обслуживается сразу на потоке сессии. API-запросы сначала определяют карту
+        // (по токену или по телу запроса) и выполняются на strand'е этой карты.
+        // Чтение игроков и состояния идёт без strand'а, по последнему опубликованному снимку карты
         template <typename Body, typename Allocator, typename Send>
         void operator()(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send) {
-            net::dispatch(
-                strand_,
-                [this, req = std::move(req), send = std::forward<Send>(send)]() mutable {
-                    if (req.method() != http::verb::get && req.method() != http::verb::head &&
-                        req.method() != http::verb::post) {
-                        return send(MakeErrorResponse(http::status::method_not_allowed,
-                            "invalidMethod",
-                            "Only GET, HEAD and POST methods are expected", req));
-                    }
+            if (SplitTarget({ req.target().data(), req.target().size() }).first == METRICS_PATH) {
+                send.SetRoute(RequestMetrics::METRICS_ROUTE);
+                if (!IsAdminAllowed(send)) {
+                    return send(MakeErrorResponse(http::status::forbidden,
+                        "forbidden", "Admin endpoints are available only from localhost", req));
+                }
+                return send(HandleMetricsRequest(req));
+            }
 
-                    if (req.target().starts_with("/api/")) {
-                        return send(HandleApiRequest(std::move(req)));
-                    }
-                    return send(HandleStaticRequest(std::move(req)));
-                });
+            if (req.method() != http::verb::get && req.method() != http::verb::head &&
+                req.method() != http::verb::post) {
+                const auto route = FindApiRoute(SplitTarget({ req.target().data(), req.target().size() }).first);
+                send.SetRoute(route ? static_cast<unsigned>(route->endpoint) : RequestMetrics::OTHER_ROUTE);
+                return send(MakeErrorResponse(http::status::method_not_allowed,
+                    "invalidMethod",
+                    "Only GET, HEAD and POST methods are expected", req,
+                    route ? route->Allow() : std::string_view{}));
+            }
+
+            if (req.target().starts_with("/api/")) {
+                return HandleApiRequest(std::move(req), Sender(std::forward<Send>(send)));
+            }
+            send.SetRoute(RequestMetrics::STATIC_ROUTE);
+            return send(HandleStaticRequest(std::move(req)));
         }
 
     private:
-        StringResponse HandleApiRequest(StringRequest&& req);
-        StringResponse HandleStaticRequest(StringRequest&& req);
+        // Метрики в формате Prometheus. Путь не под /api/, как принято у сборщиков метрик
+        static constexpr std::string_view METRICS_PATH = "/metrics";
+
+        // Сериализованный ответ для одной версии состояния карты
+        struct RenderCache {
+            std::optional<uint64_t> version;
+            uint64_t since = 0;  // только для дельты: изменения после этой версии
+            std::string body;
+            std::string etag;
+            std::string_view content_type = "application/json";
+        };
+
+        // Сколько /api/v1/game/state/wait ждёт тика, прежде чем получить текущее состояние
+        static constexpr auto STATE_WAIT_TIMEOUT = std::chrono::seconds(30);
+        // Сверх этого числа ожидающих на карте запросы получают 503
+        static constexpr size_t MAX_STATE_WAITERS = 4096;
+
+        // Запрос /api/v1/game/state/wait, ожидающий следующего тика карты
+        struct StateWaiter {
+            StringRequest req;
+            Sender send;
+            std::optional<uint64_t> since;
+            std::chrono::steady_clock::time_point deadline;
+        };
+
+        // Ответ, который сериализуется при первом обращении и дальше отдаётся всем читателям.
+        // Get можно вызывать с любых потоков
+        class LazyRender {
+        public:
+            template <typename Fn>
+            const RenderCache& Get(Fn&& render) const {
+                if (!ready_.load(std::memory_order_acquire)) {
+                    std::lock_guard lock{ mutex_ };
+                    if (!ready_.load(std::memory_order_relaxed)) {
+                        render(cache_);
+                        ready_.store(true, std::memory_order_release);
+                    }
+                }
+                return cache_;
+            }
+
+            // Только пока объектом не владеет никто, кроме вызывающего
+            void Reset() noexcept {
+                ready_.store(false, std::memory_order_relaxed);
+            }
+
+        private:
+            mutable std::mutex mutex_;
+            mutable std::atomic<bool> ready_{ false };
+            mutable RenderCache cache_;
+        };
+
+        // Состав игроков карты. Меняется только при входе игрока, поэтому общий для многих снимков
+        struct RosterSnapshot {
+            uint64_t version = 0;
+            std::vector<std::pair<uint64_t, std::string>> players;
+            LazyRender render;
+        };
 
-        StringResponse HandleJoinGame(StringRequest&& req);
-        StringResponse HandleGetPlayers(StringRequest&& req);
-        StringResponse HandleGetGameState(StringRequest&& req);
-        StringResponse HandlePlayerAction(StringRequest&& req);
-        StringResponse HandleTick(StringRequest&& req);
+        // Неизменяемый снимок состояния карты (RCU). Строится на strand'е карты после тика и входа
+        // игрока, а действия игроков из одной очереди strand'а публикуются одним снимком после них.
+        // Снимок заменяется атомарно. Обработчики чтения берут последний снимок на потоке сессии
+        // и не ждут тика. Старый снимок живёт, пока его читают
+        struct MapSnapshot {
+            struct DogState {
+                uint64_t player_id = 0;
+                std::array<double, 2> pos{};
+                std::array<double, 2> speed{};
+                char dir = 'U';
+                // Версия, на которой состояние собаки менялось последний раз
+                uint64_t changed_at = 0;
+            };
+
+            size_t map_index = 0;
+            uint64_t version = 0;
+            // Версия предыдущего снимка: клиенты, опрашивающие каждый тик, присылают такой since
+            uint64_t previous = 0;
+            std::vector<DogState> dogs;
+            std::shared_ptr<const RosterSnapshot> roster;
+
+            LazyRender state;
+            LazyRender delta;
+            // Бинарные кадры (Accept: application/x-game-state): полный и дельта от previous
+            LazyRender frame;
+            LazyRender frame_delta;
+        };
+
+        struct MapCache {
+            std::atomic<std::shared_ptr<const MapSnapshot>> snapshot;
+            // Прошлый снимок. Когда его отпустят все читатели, он заполняется заново вместо нового
+            // выделения памяти: в установившемся режиме два буфера сменяют друг друга.
+            // Доступ только со strand'а карты
+            std::shared_ptr<MapSnapshot> spare;
+            // Ожидающие в порядке прихода, а значит, и в порядке срока. Таймер работает на strand'е карты
+            std::vector<StateWaiter> state_waiters;
+            std::unique_ptr<net::steady_timer> wait_timer;
+            bool wait_timer_armed = false;
+            // Действие игрока изменило карту, но снимок ещё не опубликован
+            bool snapshot_dirty = false;
+            bool publish_scheduled = false;
+            // Ответы на действия ждут публикации снимка: клиент, получивший ответ, видит своё действие
+            std::vector<std::pair<Sender, StringResponse>> unpublished_responses;
+        };
+
+        using PlayerHandler = StringResponse(RequestHandler::*)(const StringRequest&, model::Dog);
+        using SnapshotPtr = std::shared_ptr<const MapSnapshot>;
+        using SnapshotHandler = Response(RequestHandler::*)(const StringRequest&, const SnapshotPtr&) const;
+
+        void HandleApiRequest(StringRequest&& req, Sender&& send);
+        // Файлы из кэша отдаются из памяти по ссылке, большие файлы — с диска через sendfile
+        Response HandleStaticRequest(StringRequest&& req);
+        StringResponse HandleMetricsRequest(const StringRequest& req) const;
+
+        // Находит собаку игрока по токену. Если игрок не найден, сам отправляет ответ с ошибкой
+        std::optional<model::Dog> ResolveDog(const StringRequest& req, const Sender& send) const;
+        // Находит собаку игрока по токену и вызывает handler на strand'е её карты
+        void DispatchToPlayerMap(StringRequest&& req, Sender&& send, PlayerHandler handler);
+        // Находит собаку игрока по токену и сразу вызывает handler для снимка её карты
+        void ReadPlayerMap(const StringRequest& req, const Sender& send, SnapshotHandler handler) const;
+
+        void HandleJoinGame(StringRequest&& req, Sender&& send);
+        void HandleTick(StringRequest&& req, Sender&& send);
+        Response HandleGetPlayers(const StringRequest& req, const SnapshotPtr& snapshot) const;
+        Response HandleGetGameState(const StringRequest& req, const SnapshotPtr& snapshot) const;
+        StringResponse HandlePlayerAction(const StringRequest& req, model::Dog dog);
+        void HandleWaitGameState(StringRequest&& req, Sender&& send);
+
+        // Строит снимок карты по текущему состоянию, публикует его и отправляет ответы,
+        // ждавшие публикации. Только со strand'а карты
+        void PublishSnapshot(size_t map_index);
+        // Ставит одну публикацию в конец очереди strand'а карты: она выполнится после уже
+        // ожидающих там действий и опубликует их все одним снимком
+        void SchedulePublish(size_t map_index);
+        SnapshotPtr GetSnapshot(size_t map_index) const;
+
+        // Отрисованные ответы продлевают жизнь снимка, из которого взяты
+        std::shared_ptr<const RenderCache> RenderPlayers(const SnapshotPtr& snapshot) const;
+        // Выбирает JSON или бинарный кадр по заголовку Accept. Частые варианты берутся из снимка,
+        // дельта от произвольной версии сериализуется отдельно для запроса
+        std::shared_ptr<const RenderCache> RenderState(const SnapshotPtr& snapshot, std::optional<uint64_t> since,
+            const StringRequest& req) const;
+        // Полное состояние при since == nullopt, иначе дельта с полем tick
+        void RenderStateJson(const MapSnapshot& snapshot, std::optional<uint64_t> since, RenderCache& cache) const;
+        void RenderStateFrame(const MapSnapshot& snapshot, uint64_t since, RenderCache& cache) const;
+        void WakeStateWaiters(size_t map_index);
+        // Отвечает ожидающим с истёкшим сроком и убирает тех, чьё соединение оборвано
+        void ExpireStateWaiters(size_t map_index);
+        // Заводит таймер на срок самого старого ожидающего, если он ещё не заведён
+        void ArmWaitTimer(size_t map_index);
 
         std::optional<model::Token> ExtractToken(const StringRequest& req) const;
+        // Служебные маршруты раскрывают внутреннее устройство сервера и не требуют токена
+        bool IsAdminAllowed(const Sender& send) const noexcept;
 
         static StringResponse MakeStringResponse(http::status status, std::string_view body,
             const StringRequest& req,
             std::string_view content_type = "application/json");
 
+        // Совпадает ли etag с одним из значений If-None-Match
+        static bool MatchesETag(const StringRequest& req, std::string_view etag);
+        // Условный GET: можно ли ответить 304 по If-None-Match или If-Modified-Since
+        static bool IsNotModified(const StringRequest& req, std::string_view etag,
+            std::chrono::sys_seconds last_modified);
+        // Ставит ETag версии и отвечает 304, если клиент уже получил эту версию
+        Response MakeCachedResponse(std::shared_ptr<const RenderCache> cache, const StringRequest& req) const;
+        void UpdateETag(RenderCache& cache, size_t map_index, char kind) const;
+
+        // allow — значение заголовка Allow для ответов 405
         static StringResponse MakeErrorResponse(http::status status, std::string_view code,
-            std::string_view message, const StringRequest& req);
+            std::string_view message, const StringRequest& req, std::string_view allow = {});
+
+        static std::pair<std::string_view, std::string_view> SplitTarget(std::string_view target);
+        // Разбирает необязательный параметр ?since=<tick>. Возвращает false, если он некорректен
+        static bool ParseSince(const StringRequest& req, std::optional<uint64_t>& since);
 
         static std::string DecodeUrl(std::string_view url);
-        static std::string GetMimeType(std::string_view path);
-        static bool IsSubPath(const fs::path& path, const fs::path& base);
+        // Разрешает ли клиент ответ, сжатый gzip (Accept-Encoding)
+        static bool AcceptsGzip(const StringRequest& req);
+        // Предпочитает ли клиент бинарный кадр состояния JSON'у (Accept с учётом q)
+        static bool AcceptsStateFrame(const StringRequest& req);
+
+        struct ByteRange {
+            uint64_t offset = 0;
+            uint64_t length = 0;
+        };
+        // Разбирает заголовок Range вида bytes=a-b, bytes=a- или bytes=-n для ресурса размера size.
+        // range остаётся пустым, если заголовка нет или он не поддерживается (несколько диапазонов,
+        // устаревший If-Range): тогда отдаётся весь файл. Возвращает false, если диапазон невыполним
+        static bool ParseRange(const StringRequest& req, std::string_view etag, uint64_t size,
+            std::optional<ByteRange>& range);
 
         model::Game& game_;
-        fs::path static_path_;
-        net::strand<net::io_context::executor_type> strand_;
+        const StaticCache& static_cache_;
+        const MapStrands& map_strands_;
+        const RequestMetrics& metrics_;
+        const MetricsExporter& exporter_;
+        std::vector<MapCache> map_cache_;
+        // Отличает ETag'и разных запусков сервера: версии карт после перезапуска начинаются заново
+        std::string etag_epoch_;
         std::optional<std::chrono::milliseconds> tick_period_;
+        bool remote_admin_;
     };
 
 } // namespace http_handler
\ No newline at end of file
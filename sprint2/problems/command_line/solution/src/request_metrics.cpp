@@ -0,0 +1,81 @@
+#include "request_metrics.h"
+#include "json_writer.h"
+#include <chrono>
+
+namespace http_handler {
+
+    namespace {
+
+        constexpr std::array<std::string_view, RequestMetrics::PHASE_COUNT> PHASE_NAMES = {
+            "read", "queue", "handle", "write", "total"
+        };
+
+        uint64_t ToMicroseconds(http_server::RequestTimings::Duration duration) noexcept {
+            const auto us = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+            return us > 0 ? static_cast<uint64_t>(us) : 0;
+        }
+
+        double ToMilliseconds(uint64_t us) noexcept {
+            return static_cast<double>(us) / 1000.0;
+        }
+
+    }  // namespace
+
+    void RequestMetrics::Record(const http_server::RequestTimings& timings) noexcept {
+        const size_t route = timings.route < ROUTE_COUNT ? timings.route : OTHER_ROUTE;
+        auto& histograms = histograms_[route];
+        histograms[READ].Record(ToMicroseconds(timings.read));
+        histograms[QUEUE].Record(ToMicroseconds(timings.queue));
+        histograms[HANDLE].Record(ToMicroseconds(timings.handle));
+        histograms[WRITE].Record(ToMicroseconds(timings.write));
+        histograms[TOTAL].Record(ToMicroseconds(timings.read + timings.queue + timings.handle + timings.write));
+    }
+
+    std::string RequestMetrics::ToJson() const {
+        std::string body;
+        util::JsonWriter writer{ body };
+        writer.BeginObject()
+            .Key("unit").Value("ms")
+            .Key("routes").BeginObject();
+        for (size_t route = 0; route < ROUTE_COUNT; ++route) {
+            const auto& histograms = histograms_[route];
+            const auto count = histograms[TOTAL].GetCount();
+            if (count == 0) {
+                continue;
+            }
+            writer.Key(GetRouteName(route)).BeginObject()
+                .Key("count").Value(count);
+            for (size_t phase = 0; phase < PHASE_COUNT; ++phase) {
+                const auto& histogram = histograms[phase];
+                writer.Key(PHASE_NAMES[phase]).BeginObject()
+                    .Key("p50").Value(ToMilliseconds(histogram.GetValueAtPercentile(50.0)))
+                    .Key("p99").Value(ToMilliseconds(histogram.GetValueAtPercentile(99.0)))
+                    .Key("p999").Value(ToMilliseconds(histogram.GetValueAtPercentile(99.9)))
+                    .Key("max").Value(ToMilliseconds(histogram.GetMax()))
+                    .EndObject();
+            }
+            writer.EndObject();
+        }
+        writer.EndObject().EndObject();
+        return body;
+    }
+
+    uint64_t RequestMetrics::GetResponseCount(size_t route) const noexcept {
+        return route < ROUTE_COUNT ? histograms_[route][TOTAL].GetCount() : 0;
+    }
+
+    std::string_view RequestMetrics::GetRouteName(size_t route) noexcept {
+        if (route < API_ENDPOINT_COUNT) {
+            return detail::API_ROUTES[route].path;
+        }
+        switch (route) {
+        case STATIC_ROUTE:
+            return "static";
+        case METRICS_ROUTE:
+            return "/metrics";
+        default:
+            return "other";
+        }
+    }
+
+} // namespace http_handler
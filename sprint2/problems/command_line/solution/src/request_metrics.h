@@ -0,0 +1,52 @@
+#pragma once
+#include "api_routes.h"
+#include "http_response.h"
+#include "latency_histogram.h"
+#include <array>
+#include <string>
+#include <string_view>
+
+namespace http_handler {
+
+    // Гистограммы времени обработки запросов по маршрутам и фазам (чтение, очередь strand'а,
+    // обработка, запись). Заполняется наблюдателем сессий, читается через /api/v1/admin/latency
+    class RequestMetrics {
+    public:
+        // Маршруты API нумеруются значениями ApiEndpoint, дальше идут статика, всё остальное и /metrics
+        static constexpr unsigned STATIC_ROUTE = API_ENDPOINT_COUNT;
+        static constexpr unsigned OTHER_ROUTE = API_ENDPOINT_COUNT + 1;
+        static constexpr unsigned METRICS_ROUTE = API_ENDPOINT_COUNT + 2;
+        static constexpr size_t ROUTE_COUNT = API_ENDPOINT_COUNT + 3;
+
+        enum Phase : size_t {
+            READ,
+            QUEUE,
+            HANDLE,
+            WRITE,
+            TOTAL,
+            PHASE_COUNT,
+        };
+
+        RequestMetrics() = default;
+        RequestMetrics(const RequestMetrics&) = delete;
+        RequestMetrics& operator=(const RequestMetrics&) = delete;
+
+        // Можно вызывать из любых потоков
+        void Record(const http_server::RequestTimings& timings) noexcept;
+
+        // {"unit":"ms","routes":{"<маршрут>":{"count":N,"read":{"p50":..,"p99":..,"p999":..,"max":..},...}}}.
+        // Маршруты без запросов пропускаются
+        std::string ToJson() const;
+
+        // Сколько ответов отправлено по маршруту
+        uint64_t GetResponseCount(size_t route) const noexcept;
+
+        static std::string_view GetRouteName(size_t route) noexcept;
+
+    private:
+        using Histograms = std::array<util::LatencyHistogram, PHASE_COUNT>;
+
+        std::array<Histograms, ROUTE_COUNT> histograms_;
+    };
+
+} // namespace http_handler
@@ -0,0 +1,58 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace util {
+
+    namespace detail {
+
+        // Потоки получают номера шардов по кругу при первом обращении
+        inline size_t GetThreadShard() noexcept {
+            static std::atomic<size_t> next_shard{ 0 };
+            thread_local const size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed);
+            return shard;
+        }
+
+    }  // namespace detail
+
+    // Счётчик, разбитый на шарды по потокам: каждый поток пишет в свою кэш-линию, поэтому
+    // запись не конкурирует с другими потоками, а чтение просто суммирует шарды.
+    // Сумма, прочитанная во время записи, может не учитывать самые свежие изменения
+    template <typename T>
+    class ShardedValue {
+    public:
+        static constexpr size_t SHARD_COUNT = 16;
+
+        void Add(T delta) noexcept {
+            shards_[detail::GetThreadShard() % SHARD_COUNT].value.fetch_add(delta, std::memory_order_relaxed);
+        }
+
+        void Sub(T delta) noexcept {
+            shards_[detail::GetThreadShard() % SHARD_COUNT].value.fetch_sub(delta, std::memory_order_relaxed);
+        }
+
+        T Get() const noexcept {
+            T total{};
+            for (const auto& shard : shards_) {
+                total += shard.value.load(std::memory_order_relaxed);
+            }
+            return total;
+        }
+
+    private:
+        struct alignas(64) Shard {
+            std::atomic<T> value{};
+        };
+
+        std::array<Shard, SHARD_COUNT> shards_;
+    };
+
+    // Только растёт
+    using ShardedCounter = ShardedValue<uint64_t>;
+    // Растёт и убывает, например число открытых соединений. Увеличение и уменьшение
+    // могут прийти из разных шардов, поэтому смысл имеет только сумма
+    using ShardedGauge = ShardedValue<int64_t>;
+
+} // namespace util
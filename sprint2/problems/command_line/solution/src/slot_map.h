@@ -0,0 +1,155 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace util {
+
+    // Контейнер со стабильными 32-битными дескрипторами (generational index).
+    // Значения лежат в одном плотном массиве, поэтому обход линейный; удаление переносит
+    // последний элемент на место удалённого, а поколение в дескрипторе отсекает устаревшие ссылки.
+    template <typename T>
+    class SlotMap {
+    public:
+        // Младшие 24 бита — номер ячейки, старшие 8 — поколение
+        class Handle {
+        public:
+            static constexpr uint32_t INDEX_BITS = 24;
+            static constexpr uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+
+            constexpr Handle() noexcept = default;
+            constexpr Handle(uint32_t slot, uint32_t generation) noexcept
+                : value_{ (generation << INDEX_BITS) | (slot & INDEX_MASK) } {
+            }
+
+            static constexpr Handle FromValue(uint32_t value) noexcept {
+                Handle handle;
+                handle.value_ = value;
+                return handle;
+            }
+
+            constexpr uint32_t GetValue() const noexcept {
+                return value_;
+            }
+
+            constexpr uint32_t GetSlot() const noexcept {
+                return value_ & INDEX_MASK;
+            }
+
+            constexpr uint32_t GetGeneration() const noexcept {
+                return value_ >> INDEX_BITS;
+            }
+
+            constexpr bool operator==(const Handle&) const noexcept = default;
+
+        private:
+            uint32_t value_ = UINT32_MAX;
+        };
+
+        // Дескриптор для значения, которое будет добавлено следующим вызовом Insert
+        Handle NextHandle() const {
+            if (!free_slots_.empty()) {
+                const uint32_t slot = free_slots_.back();
+                return Handle{ slot, slots_[slot].generation };
+            }
+            if (slots_.size() >= Handle::INDEX_MASK) {
+                throw std::length_error("SlotMap is full");
+            }
+            return Handle{ static_cast<uint32_t>(slots_.size()), 0 };
+        }
+
+        Handle Insert(T value) {
+            const Handle handle = NextHandle();
+            // Резерв заранее, чтобы push_back в dense_to_slot_ ниже не бросал. Ёмкость растёт вдвое:
+            // резерв ровно на один элемент перевыделял бы массив на каждой вставке
+            if (dense_to_slot_.size() == dense_to_slot_.capacity()) {
+                dense_to_slot_.reserve(std::max<size_t>(2 * dense_to_slot_.capacity(), 8));
+            }
+            values_.push_back(std::move(value));
+            if (handle.GetSlot() == slots_.size()) {
+                try {
+                    slots_.push_back(Slot{});
+                } catch (...) {
+                    values_.pop_back();
+                    throw;
+                }
+            } else {
+                free_slots_.pop_back();
+            }
+            dense_to_slot_.push_back(handle.GetSlot());
+            slots_[handle.GetSlot()].dense = static_cast<uint32_t>(values_.size() - 1);
+            return handle;
+        }
+
+        bool Erase(Handle handle) {
+            if (!Contains(handle)) {
+                return false;
+            }
+            Slot& slot = slots_[handle.GetSlot()];
+            const uint32_t last = static_cast<uint32_t>(values_.size() - 1);
+            if (slot.dense != last) {
+                values_[slot.dense] = std::move(values_[last]);
+                dense_to_slot_[slot.dense] = dense_to_slot_[last];
+                slots_[dense_to_slot_[last]].dense = slot.dense;
+            }
+            values_.pop_back();
+            dense_to_slot_.pop_back();
+
+            slot.dense = EMPTY;
+            // Поколение занимает 8 бит, поэтому после 256 переиспользований ячейка выводится из оборота
+            if (++slot.generation <= (UINT32_MAX >> Handle::INDEX_BITS)) {
+                free_slots_.push_back(handle.GetSlot());
+            }
+            return true;
+        }
+
+        bool Contains(Handle handle) const noexcept {
+            const uint32_t index = handle.GetSlot();
+            return index < slots_.size()
+                && slots_[index].dense != EMPTY
+                && slots_[index].generation == handle.GetGeneration();
+        }
+
+        T* Find(Handle handle) noexcept {
+            return Contains(handle) ? &values_[slots_[handle.GetSlot()].dense] : nullptr;
+        }
+
+        const T* Find(Handle handle) const noexcept {
+            return Contains(handle) ? &values_[slots_[handle.GetSlot()].dense] : nullptr;
+        }
+
+        size_t Size() const noexcept {
+            return values_.size();
+        }
+
+        void Reserve(size_t capacity) {
+            values_.reserve(capacity);
+            dense_to_slot_.reserve(capacity);
+            slots_.reserve(capacity);
+        }
+
+        // Обход в порядке плотного массива; порядок меняется после Erase
+        auto begin() const noexcept {
+            return values_.begin();
+        }
+
+        auto end() const noexcept {
+            return values_.end();
+        }
+
+    private:
+        static constexpr uint32_t EMPTY = UINT32_MAX;
+
+        struct Slot {
+            uint32_t dense = EMPTY;
+            uint32_t generation = 0;
+        };
+
+        std::vector<T> values_;
+        std::vector<uint32_t> dense_to_slot_;
+        std::vector<Slot> slots_;
+        std::vector<uint32_t> free_slots_;
+    };
+
+} // namespace util
@@ -0,0 +1,140 @@
+#include "spatial_index.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace model {
+
+    namespace {
+        // Собака считается на дороге, если отстоит от её оси не более чем на половину клетки
+        constexpr double ROAD_HALF_WIDTH = 0.5;
+        // Среднее число ячеек сетки на один объект карты
+        constexpr double CELLS_PER_ITEM = 4.0;
+    }
+
+    template <typename GetBounds>
+    SpatialIndex::Layer SpatialIndex::BuildLayer(size_t count, GetBounds get_bounds) const {
+        Layer layer;
+        layer.offsets.assign(columns_ * rows_ + 1, 0);
+
+        auto for_each_cell = [this](const Bounds& b, auto&& fn) {
+            const auto col_from = static_cast<size_t>((b.min_x - origin_x_) / cell_size_);
+            const auto col_to = static_cast<size_t>((b.max_x - origin_x_) / cell_size_);
+            const auto row_from = static_cast<size_t>((b.min_y - origin_y_) / cell_size_);
+            const auto row_to = static_cast<size_t>((b.max_y - origin_y_) / cell_size_);
+            for (size_t row = row_from; row <= std::min(row_to, rows_ - 1); ++row) {
+                for (size_t col = col_from; col <= std::min(col_to, columns_ - 1); ++col) {
+                    fn(row * columns_ + col);
+                }
+            }
+        };
+
+        for (size_t i = 0; i < count; ++i) {
+            for_each_cell(get_bounds(i), [&layer](size_t cell) {
+                ++layer.offsets[cell + 1];
+            });
+        }
+        for (size_t cell = 1; cell < layer.offsets.size(); ++cell) {
+            layer.offsets[cell] += layer.offsets[cell - 1];
+        }
+
+        layer.items.resize(layer.offsets.back());
+        std::vector<uint32_t> fill(layer.offsets.begin(), layer.offsets.end() - 1);
+        for (size_t i = 0; i < count; ++i) {
+            for_each_cell(get_bounds(i), [&layer, &fill, i](size_t cell) {
+                layer.items[fill[cell]++] = static_cast<ItemIndex>(i);
+            });
+        }
+        return layer;
+    }
+
+    void SpatialIndex::Build(const std::vector<Road>& roads, const std::vector<Building>& buildings) {
+        auto road_bounds = [&roads](size_t i) {
+            const Point start = roads[i].GetStart();
+            const Point end = roads[i].GetEnd();
+            return Bounds{
+                std::min(start.x, end.x) - ROAD_HALF_WIDTH,
+                std::min(start.y, end.y) - ROAD_HALF_WIDTH,
+                std::max(start.x, end.x) + ROAD_HALF_WIDTH,
+                std::max(start.y, end.y) + ROAD_HALF_WIDTH
+            };
+        };
+        auto building_bounds = [&buildings](size_t i) {
+            const Rectangle& r = buildings[i].GetBounds();
+            const double x0 = r.position.x;
+            const double y0 = r.position.y;
+            const double x1 = x0 + r.size.width;
+            const double y1 = y0 + r.size.height;
+            return Bounds{ std::min(x0, x1), std::min(y0, y1), std::max(x0, x1), std::max(y0, y1) };
+        };
+
+        Bounds total{
+            std::numeric_limits<double>::max(), std::numeric_limits<double>::max(),
+            std::numeric_limits<double>::lowest(), std::numeric_limits<double>::lowest()
+        };
+        auto extend = [&total](const Bounds& b) {
+            total.min_x = std::min(total.min_x, b.min_x);
+            total.min_y = std::min(total.min_y, b.min_y);
+            total.max_x = std::max(total.max_x, b.max_x);
+            total.max_y = std::max(total.max_y, b.max_y);
+        };
+        for (size_t i = 0; i < roads.size(); ++i) {
+            extend(road_bounds(i));
+        }
+        for (size_t i = 0; i < buildings.size(); ++i) {
+            extend(building_bounds(i));
+        }
+
+        *this = SpatialIndex{};
+        if (roads.empty() && buildings.empty()) {
+            built_ = true;
+            return;
+        }
+
+        const double width = total.max_x - total.min_x;
+        const double height = total.max_y - total.min_y;
+        const double target_cells = CELLS_PER_ITEM * static_cast<double>(roads.size() + buildings.size());
+
+        origin_x_ = total.min_x;
+        origin_y_ = total.min_y;
+        cell_size_ = std::max(1.0, std::sqrt(width * height / target_cells));
+        columns_ = static_cast<size_t>(width / cell_size_) + 1;
+        rows_ = static_cast<size_t>(height / cell_size_) + 1;
+
+        roads_ = BuildLayer(roads.size(), road_bounds);
+        buildings_ = BuildLayer(buildings.size(), building_bounds);
+        built_ = true;
+    }
+
+    bool SpatialIndex::IsBuilt() const noexcept {
+        return built_;
+    }
+
+    SpatialIndex::Items SpatialIndex::RoadsAt(double x, double y) const noexcept {
+        return ItemsAt(roads_, x, y);
+    }
+
+    SpatialIndex::Items SpatialIndex::BuildingsAt(double x, double y) const noexcept {
+        return ItemsAt(buildings_, x, y);
+    }
+
+    bool SpatialIndex::CellAt(double x, double y, size_t& cell) const noexcept {
+        const double col = std::floor((x - origin_x_) / cell_size_);
+        const double row = std::floor((y - origin_y_) / cell_size_);
+        if (!(col >= 0.0 && row >= 0.0 &&
+            col < static_cast<double>(columns_) && row < static_cast<double>(rows_))) {
+            return false;
+        }
+        cell = static_cast<size_t>(row) * columns_ + static_cast<size_t>(col);
+        return true;
+    }
+
+    SpatialIndex::Items SpatialIndex::ItemsAt(const Layer& layer, double x, double y) const noexcept {
+        size_t cell;
+        if (layer.offsets.empty() || !CellAt(x, y, cell)) {
+            return {};
+        }
+        return Items{ layer.items.data() + layer.offsets[cell], layer.items.data() + layer.offsets[cell + 1] };
+    }
+
+} // namespace model
@@ -0,0 +1,50 @@
+#pragma once
+#include "model.h"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace model {
+
+    // Равномерная сетка над картой: для каждой ячейки хранит индексы дорог и зданий,
+    // которые её задевают. Списки в ячейке упорядочены по возрастанию индекса,
+    // поэтому первый подходящий кандидат совпадает с результатом линейного прохода.
+    class SpatialIndex {
+    public:
+        using ItemIndex = uint32_t;
+        using Items = std::span<const ItemIndex>;
+
+        void Build(const std::vector<Road>& roads, const std::vector<Building>& buildings);
+
+        bool IsBuilt() const noexcept;
+        Items RoadsAt(double x, double y) const noexcept;
+        Items BuildingsAt(double x, double y) const noexcept;
+
+    private:
+        // Ячейки хранятся в формате CSR: offsets[cell]..offsets[cell + 1] в items
+        struct Layer {
+            std::vector<uint32_t> offsets;
+            std::vector<ItemIndex> items;
+        };
+
+        struct Bounds {
+            double min_x, min_y, max_x, max_y;
+        };
+
+        template <typename GetBounds>
+        Layer BuildLayer(size_t count, GetBounds get_bounds) const;
+
+        bool CellAt(double x, double y, size_t& cell) const noexcept;
+        Items ItemsAt(const Layer& layer, double x, double y) const noexcept;
+
+        bool built_ = false;
+        double origin_x_ = 0.0;
+        double origin_y_ = 0.0;
+        double cell_size_ = 1.0;
+        size_t columns_ = 0;
+        size_t rows_ = 0;
+        Layer roads_;
+        Layer buildings_;
+    };
+
+} // namespace model
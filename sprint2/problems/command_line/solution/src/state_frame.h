@@ -0,0 +1,66 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace util {
+
+    // Упакованный бинарный кадр состояния карты (Content-Type: application/x-game-state).
+    // Все числа little-endian:
+    //   char[4] magic   "GST1"
+    //   u64     tick    версия состояния карты, как поле "tick" в JSON-дельте
+    //   u32     count   число записей
+    //   count записей по 37 байт:
+    //     u32 id, f64 x, f64 y, f64 vx, f64 vy, u8 dir ('U', 'D', 'L', 'R')
+    // Эталонный декодер для браузера: static/js/game_state_decoder.js
+    class StateFrameWriter {
+    public:
+        static constexpr std::string_view CONTENT_TYPE = "application/x-game-state";
+
+        StateFrameWriter(std::string& out, uint64_t tick)
+            : out_(out)
+            , count_offset_(out.size() + MAGIC.size() + sizeof(uint64_t)) {
+            out_.append(MAGIC);
+            Append(tick);
+            Append(uint32_t{ 0 });
+        }
+
+        void Add(uint32_t id, std::array<double, 2> pos, std::array<double, 2> speed, char dir) {
+            Append(id);
+            Append(pos[0]);
+            Append(pos[1]);
+            Append(speed[0]);
+            Append(speed[1]);
+            out_ += dir;
+            ++count_;
+        }
+
+        // Записывает итоговое число записей в заголовок
+        void Finish() {
+            for (size_t i = 0; i < sizeof(count_); ++i) {
+                out_[count_offset_ + i] = static_cast<char>((count_ >> (8 * i)) & 0xFF);
+            }
+        }
+
+    private:
+        static constexpr std::string_view MAGIC = "GST1";
+
+        template <typename Integer>
+        void Append(Integer value) {
+            for (size_t i = 0; i < sizeof(value); ++i) {
+                out_ += static_cast<char>((value >> (8 * i)) & 0xFF);
+            }
+        }
+
+        void Append(double value) {
+            Append(std::bit_cast<uint64_t>(value));
+        }
+
+        std::string& out_;
+        size_t count_offset_;
+        uint32_t count_ = 0;
+    };
+
+} // namespace util
@@ -0,0 +1,325 @@
+#include "static_cache.h"
+#include "http_date.h"
+#include "logger.h"
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <sys/inotify.h>
+#endif
+
+namespace http_handler {
+
+    namespace {
+
+        // Не сжимаем файлы, которые уже сжаты (картинки, аудио)
+        bool IsCompressible(std::string_view mime_type) {
+            return mime_type.starts_with("text/")
+                || mime_type == "application/json"
+                || mime_type == "application/xml"
+                || mime_type == "image/svg+xml"
+                || mime_type == "image/bmp"
+                || mime_type == "image/vnd.microsoft.icon";
+        }
+
+        std::string ReadFile(const fs::path& path, uintmax_t size) {
+            std::ifstream file(path, std::ios::binary);
+            if (!file) {
+                throw std::runtime_error("Failed to open file " + path.string());
+            }
+            std::string content(static_cast<size_t>(size), '\0');
+            file.read(content.data(), static_cast<std::streamsize>(content.size()));
+            content.resize(static_cast<size_t>(file.gcount()));
+            return content;
+        }
+
+        std::string Gzip(std::string_view content) {
+            namespace io = boost::iostreams;
+            std::string compressed;
+            {
+                io::filtering_ostream out;
+                out.push(io::gzip_compressor(io::gzip_params(io::gzip::best_compression)));
+                out.push(io::back_inserter(compressed));
+                out.write(content.data(), static_cast<std::streamsize>(content.size()));
+            }
+            return compressed;
+        }
+
+        // FNV-1a по содержимому файла
+        std::string MakeETag(std::string_view content) {
+            uint64_t hash = 14695981039346656037ull;
+            for (const char c : content) {
+                hash ^= static_cast<uint8_t>(c);
+                hash *= 1099511628211ull;
+            }
+            std::array<char, 16> hex;
+            constexpr char DIGITS[] = "0123456789abcdef";
+            for (size_t i = 0; i < hex.size(); ++i) {
+                hex[hex.size() - 1 - i] = DIGITS[(hash >> (4 * i)) & 0xF];
+            }
+            return '"' + std::string(hex.data(), hex.size()) + '"';
+        }
+
+        std::string ToLower(std::string text) {
+            std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) {
+                return std::tolower(c);
+                });
+            return text;
+        }
+
+        // Лежит ли path внутри каталога base. Оба пути канонические
+        bool IsSubPath(const fs::path& path, const fs::path& base) {
+            const auto [base_end, path_it] = std::mismatch(base.begin(), base.end(), path.begin(), path.end());
+            return base_end == base.end() && path_it != path.end();
+        }
+
+        // path — канонический путь к содержимому, тип определяется по имени в каталоге (имени ссылки)
+        std::shared_ptr<StaticFile> LoadFile(const fs::path& path, const fs::path& name) {
+            auto file = std::make_shared<StaticFile>();
+            file->path = path;
+            file->mime_type = StaticCache::GetMimeType(name.filename().string());
+            file->size = fs::file_size(path);
+            file->last_modified = std::chrono::floor<std::chrono::seconds>(
+                std::chrono::file_clock::to_sys(fs::last_write_time(path)));
+            file->last_modified_text = util::FormatHttpDate(file->last_modified);
+
+            if (file->size <= StaticCache::MAX_CACHED_FILE_SIZE) {
+                file->content = ReadFile(path, file->size);
+                file->size = file->content->size();
+                file->etag = MakeETag(*file->content);
+                if (IsCompressible(file->mime_type)) {
+                    // Сжатый вариант храним, только если он меньше исходного хотя бы на 10%
+                    auto gzip = Gzip(*file->content);
+                    if (gzip.size() * 10 < file->content->size() * 9) {
+                        file->gzip = std::move(gzip);
+                        file->gzip_etag = file->etag;
+                        file->gzip_etag.insert(file->gzip_etag.size() - 1, "-gz");
+                    }
+                }
+            }
+            else {
+                // Большие файлы не держим в памяти: ETag строим по размеру и времени изменения
+                file->etag = '"' + std::to_string(file->size) + '-'
+                    + std::to_string(file->last_modified.time_since_epoch().count()) + '"';
+            }
+            return file;
+        }
+
+    }  // namespace
+
+#ifdef __linux__
+    // Следит за всеми подкаталогами через inotify. Изменения копятся RELOAD_DELAY,
+    // после чего каталог перечитывается целиком
+    class StaticCache::Watcher : public std::enable_shared_from_this<Watcher> {
+    public:
+        Watcher(net::io_context& ioc, StaticCache& cache)
+            : strand_(net::make_strand(ioc))
+            , descriptor_(strand_)
+            , timer_(strand_)
+            , cache_(cache) {
+            const int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            if (fd < 0) {
+                throw std::runtime_error("inotify_init1 failed");
+            }
+            descriptor_.assign(fd);
+        }
+
+        void Start() {
+            net::dispatch(strand_, [self = shared_from_this()] {
+                self->AddWatches();
+                self->Read();
+            });
+        }
+
+    private:
+        static constexpr auto RELOAD_DELAY = std::chrono::milliseconds(200);
+        static constexpr uint32_t EVENTS = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE
+            | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+
+        // Повторное добавление уже отслеживаемого каталога безопасно: inotify вернёт тот же дескриптор
+        void AddWatches() {
+            const int fd = descriptor_.native_handle();
+            inotify_add_watch(fd, cache_.GetRoot().c_str(), EVENTS);
+            std::error_code ec;
+            for (fs::recursive_directory_iterator it(cache_.GetRoot(), ec), end; !ec && it != end; it.increment(ec)) {
+                if (it->is_directory(ec)) {
+                    inotify_add_watch(fd, it->path().c_str(), EVENTS);
+                }
+            }
+        }
+
+        void Read() {
+            descriptor_.async_read_some(net::buffer(buffer_),
+                [self = shared_from_this()](boost::system::error_code ec, size_t) {
+                    if (ec) {
+                        if (ec != net::error::operation_aborted) {
+                            logger::Logger::GetInstance().Log("static files watcher stopped", {
+                                { "code", ec.value() },
+                                { "text", ec.message() } });
+                        }
+                        return;
+                    }
+                    self->ScheduleReload();
+                    self->Read();
+                });
+        }
+
+        void ScheduleReload() {
+            timer_.expires_after(RELOAD_DELAY);
+            timer_.async_wait([self = shared_from_this()](boost::system::error_code ec) {
+                if (ec) {
+                    return;
+                }
+                try {
+                    self->AddWatches();
+                    self->cache_.Reload();
+                }
+                catch (const std::exception& e) {
+                    // Оставляем прежний снимок
+                    logger::Logger::GetInstance().Log("failed to reload static files", {
+                        { "text", e.what() } });
+                }
+            });
+        }
+
+        net::strand<net::io_context::executor_type> strand_;
+        net::posix::stream_descriptor descriptor_;
+        net::steady_timer timer_;
+        std::array<char, 4096> buffer_;
+        StaticCache& cache_;
+    };
+#endif
+
+    StaticCache::StaticCache(fs::path root, MaxAgeByExtension max_age)
+        : root_(fs::weakly_canonical(root))
+        , max_age_(std::move(max_age)) {
+        Reload();
+    }
+
+    StaticCache::~StaticCache() = default;
+
+    const fs::path& StaticCache::GetRoot() const noexcept {
+        return root_;
+    }
+
+    std::shared_ptr<const StaticFile> StaticCache::Find(std::string_view path) const {
+        const auto snapshot = GetSnapshot();
+        if (auto it = snapshot->find(path); it != snapshot->end()) {
+            return it->second;
+        }
+        return nullptr;
+    }
+
+    void StaticCache::Reload() {
+        auto files = std::make_shared<Files>();
+        for (const auto& entry : fs::recursive_directory_iterator(root_, fs::directory_options::skip_permission_denied)) {
+            std::error_code ec;
+            if (!entry.is_regular_file(ec)) {
+                continue;
+            }
+            // Символическая ссылка может вести за пределы корня: такие файлы не отдаём
+            const auto target = fs::canonical(entry.path(), ec);
+            if (ec || !IsSubPath(target, root_)) {
+                logger::Logger::GetInstance().Log("static file skipped", {
+                    { "path", entry.path().string() },
+                    { "text", ec ? ec.message() : "outside of www-root" } });
+                continue;
+            }
+
+            std::shared_ptr<StaticFile> file;
+            try {
+                file = LoadFile(target, entry.path());
+            }
+            catch (const std::exception& e) {
+                // Один нечитаемый файл не должен мешать отдавать остальные
+                logger::Logger::GetInstance().Log("static file skipped", {
+                    { "path", entry.path().string() },
+                    { "text", e.what() } });
+                continue;
+            }
+            file->cache_control = MakeCacheControl(entry.path());
+            const auto relative = entry.path().lexically_relative(root_).generic_string();
+            files->emplace(relative, file);
+
+            // Каталог отдаёт свой index.html: "dir" и "dir/", для корня — пустой путь
+            if (entry.path().filename() == "index.html") {
+                const auto dir = entry.path().parent_path().lexically_relative(root_).generic_string();
+                if (dir == ".") {
+                    files->emplace("", file);
+                }
+                else {
+                    files->emplace(dir, file);
+                    files->emplace(dir + '/', file);
+                }
+            }
+        }
+
+        snapshot_.store(std::move(files), std::memory_order_release);
+    }
+
+    void StaticCache::Watch(net::io_context& ioc) {
+#ifdef __linux__
+        watcher_ = std::make_shared<Watcher>(ioc, *this);
+        watcher_->Start();
+#else
+        throw std::runtime_error("Watching static files is supported only on Linux");
+#endif
+    }
+
+    std::string StaticCache::MakeCacheControl(const fs::path& path) const {
+        if (auto it = max_age_.find(ToLower(path.extension().string())); it != max_age_.end()) {
+            return "public, max-age=" + std::to_string(it->second.count());
+        }
+        return "no-cache";
+    }
+
+    std::shared_ptr<const StaticCache::Files> StaticCache::GetSnapshot() const {
+        return snapshot_.load(std::memory_order_acquire);
+    }
+
+    std::string_view StaticCache::GetMimeType(std::string_view path) {
+        static const std::unordered_map<std::string_view, std::string_view> mime_types = {
+            {".htm", "text/html"},
+            {".html", "text/html"},
+            {".css", "text/css"},
+            {".txt", "text/plain"},
+            {".js", "text/javascript"},
+            {".json", "application/json"},
+            {".xml", "application/xml"},
+            {".png", "image/png"},
+            {".jpg", "image/jpeg"},
+            {".jpe", "image/jpeg"},
+            {".jpeg", "image/jpeg"},
+            {".gif", "image/gif"},
+            {".bmp", "image/bmp"},
+            {".ico", "image/vnd.microsoft.icon"},
+            {".tiff", "image/tiff"},
+            {".tif", "image/tiff"},
+            {".svg", "image/svg+xml"},
+            {".svgz", "image/svg+xml"},
+            {".mp3", "audio/mpeg"}
+        };
+
+        auto pos = path.rfind('.');
+        if (pos == std::string_view::npos) {
+            return "application/octet-stream";
+        }
+
+        auto it = mime_types.find(ToLower(std::string(path.substr(pos))));
+        if (it == mime_types.end()) {
+            return "application/octet-stream";
+        }
+        return it->second;
+    }
+
+} // namespace http_handler
@@ -0,0 +1,86 @@
+#pragma once
+#include <boost/asio/io_context.hpp>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace http_handler {
+
+    namespace fs = std::filesystem;
+    namespace net = boost::asio;
+
+    // Статический файл, загруженный в память при старте. Содержимое неизменяемо:
+    // при обновлении каталога строится новый снимок, а старые записи живут, пока на них ссылаются
+    struct StaticFile {
+        fs::path path;
+        std::string mime_type;
+        uintmax_t size = 0;
+        // Сильный ETag по содержимому, в кавычках
+        std::string etag;
+        std::chrono::sys_seconds last_modified;
+        // Заголовки Last-Modified и Cache-Control, подготовленные при загрузке
+        std::string last_modified_text;
+        std::string cache_control;
+        // Нет, если файл больше MAX_CACHED_FILE_SIZE: такой файл читается с диска
+        std::optional<std::string> content;
+        // Сжатый gzip вариант, если сжатие заметно уменьшает размер, и его собственный ETag
+        std::optional<std::string> gzip;
+        std::string gzip_etag;
+    };
+
+    class StaticCache {
+    public:
+        static constexpr uintmax_t MAX_CACHED_FILE_SIZE = 4 * 1024 * 1024;
+
+        // max-age по расширению файла в нижнем регистре с точкой (".js"). Файлы с другими
+        // расширениями отдаются с "no-cache" и перепроверяются по ETag при каждом обращении
+        using MaxAgeByExtension = std::unordered_map<std::string, std::chrono::seconds>;
+
+        explicit StaticCache(fs::path root, MaxAgeByExtension max_age = {});
+        ~StaticCache();
+
+        StaticCache(const StaticCache&) = delete;
+        StaticCache& operator=(const StaticCache&) = delete;
+
+        const fs::path& GetRoot() const noexcept;
+
+        // path — декодированный путь из URL без ведущего '/'. Для каталогов возвращает их index.html
+        std::shared_ptr<const StaticFile> Find(std::string_view path) const;
+
+        // Перечитывает каталог и атомарно подменяет снимок
+        void Reload();
+        // Следит за каталогом через inotify и перечитывает его после изменений
+        void Watch(net::io_context& ioc);
+
+        static std::string_view GetMimeType(std::string_view path);
+
+    private:
+        // Позволяет искать по std::string_view без создания строки
+        struct PathHasher {
+            using is_transparent = void;
+            size_t operator()(std::string_view path) const noexcept {
+                return std::hash<std::string_view>{}(path);
+            }
+        };
+        using Files = std::unordered_map<std::string, std::shared_ptr<const StaticFile>,
+            PathHasher, std::equal_to<>>;
+        class Watcher;
+
+        std::shared_ptr<const Files> GetSnapshot() const;
+
+        std::string MakeCacheControl(const fs::path& path) const;
+
+        fs::path root_;
+        MaxAgeByExtension max_age_;
+        // Перечитывание каталога подменяет снимок целиком, запросы читают его без блокировки
+        std::atomic<std::shared_ptr<const Files>> snapshot_;
+        std::shared_ptr<Watcher> watcher_;
+    };
+
+} // namespace http_handler
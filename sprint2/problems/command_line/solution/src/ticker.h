@@ -2,22 +2,56 @@
 #pragma once
 #include <boost/asio/strand.hpp>
 #include <boost/asio/steady_timer.hpp>
+#include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <functional>
 
 namespace net = boost::asio;
 
+// Вызывает обработчик с периодом period. По умолчанию delta — реально прошедшее время,
+// и после задержки следующий тик получает большой шаг. При max_steps > 0 включается
+// фиксированный шаг: прошедшее время копится, обработчик вызывается шагами delta == period,
+// не больше max_steps за одно срабатывание. Время сверх этого отбрасывается, а пока предыдущий
+// тик не применён, новые шаги не запускаются: при перегрузке игра замедляется, но не прыгает
 class Ticker : public std::enable_shared_from_this<Ticker> {
 public:
     using Strand = net::strand<net::io_context::executor_type>;
-    using Handler = std::function<void(std::chrono::milliseconds delta)>;
+    // done вызывается (на любом потоке), когда тик полностью применён: по нему считается длительность тика
+    using Handler = std::function<void(std::chrono::milliseconds delta, std::function<void()> done)>;
 
-    Ticker(Strand strand, std::chrono::milliseconds period, Handler handler)
+    struct Stats {
+        // Срабатывания таймера
+        uint64_t ticks = 0;
+        // Вызовы обработчика (шаги симуляции)
+        uint64_t steps = 0;
+        // Срабатывания, когда игра отставала: предыдущий тик ещё не применён или накопилось больше шага
+        uint64_t overruns = 0;
+        // Шаги, отброшенные из-за ограничения max_steps
+        uint64_t dropped_steps = 0;
+        std::chrono::microseconds last_duration{};
+        std::chrono::microseconds max_duration{};
+        // Насколько таймер сработал позже запланированного
+        std::chrono::microseconds last_lag{};
+        std::chrono::microseconds max_lag{};
+    };
+
+    Ticker(Strand strand, std::chrono::milliseconds period, Handler handler, unsigned max_steps = 0)
         : strand_{ strand }
         , period_{ period }
+        , max_steps_{ max_steps }
         , handler_{ std::move(handler) } {
     }
 
+    // Можно вызывать с любого потока
+    Stats GetStats() const noexcept {
+        using std::chrono::microseconds;
+        constexpr auto order = std::memory_order_relaxed;
+        return { ticks_.load(order), steps_.load(order), overruns_.load(order), dropped_steps_.load(order),
+            microseconds{ last_duration_us_.load(order) }, microseconds{ max_duration_us_.load(order) },
+            microseconds{ last_lag_us_.load(order) }, microseconds{ max_lag_us_.load(order) } };
+    }
+
     void Start() {
         net::dispatch(strand_, [self = shared_from_this()] {
             self->last_tick_ = Clock::now();
@@ -26,9 +60,19 @@ public:
     }
 
 private:
+    using Clock = std::chrono::steady_clock;
+
     void ScheduleTick() {
         assert(strand_.running_in_this_thread());
-        timer_.expires_after(period_);
+        // В режиме фиксированного шага держим ровную сетку срабатываний, чтобы задержки
+        // таймера не накапливались. После долгой паузы сетка начинается заново
+        const auto next = timer_.expiry() + period_;
+        if (max_steps_ > 0 && next > Clock::now()) {
+            timer_.expires_at(next);
+        }
+        else {
+            timer_.expires_after(period_);
+        }
         timer_.async_wait([self = shared_from_this()](boost::system::error_code ec) {
             self->OnTick(ec);
             });
@@ -40,22 +84,88 @@ private:
 
         if (!ec) {
             auto this_tick = Clock::now();
-            auto delta = duration_cast<milliseconds>(this_tick - last_tick_);
+            auto elapsed = this_tick - last_tick_;
             last_tick_ = this_tick;
+            Store(last_lag_us_, max_lag_us_, duration_cast<microseconds>(this_tick - timer_.expiry()));
+            ticks_.fetch_add(1, std::memory_order_relaxed);
+
+            if (max_steps_ == 0) {
+                RunSteps(1, duration_cast<milliseconds>(elapsed), this_tick);
+            }
+            else {
+                accumulator_ += elapsed;
+                if (pending_steps_.load(std::memory_order_acquire) > 0) {
+                    // Предыдущий тик ещё выполняется на strand'ах карт: время копится до следующего срабатывания
+                    overruns_.fetch_add(1, std::memory_order_relaxed);
+                }
+                else {
+                    auto due = static_cast<uint64_t>(accumulator_ / period_);
+                    if (due > 1) {
+                        overruns_.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    if (due > max_steps_) {
+                        // Лишние шаги отбрасываем, остаток меньше шага сохраняется
+                        dropped_steps_.fetch_add(due - max_steps_, std::memory_order_relaxed);
+                        due = max_steps_;
+                        accumulator_ = accumulator_ % period_ + period_ * static_cast<Clock::rep>(due);
+                    }
+                    accumulator_ -= period_ * static_cast<Clock::rep>(due);
+                    if (due > 0) {
+                        RunSteps(due, period_, this_tick);
+                    }
+                }
+            }
+            ScheduleTick();
+        }
+    }
+
+    // Вызывает обработчик count раз с шагом delta. Длительность тика считается до завершения последнего шага
+    void RunSteps(uint64_t count, std::chrono::milliseconds delta, Clock::time_point start) {
+        using namespace std::chrono;
+        pending_steps_.fetch_add(count, std::memory_order_relaxed);
+        steps_.fetch_add(count, std::memory_order_relaxed);
+        auto done = [self = shared_from_this(), start] {
+            if (self->pending_steps_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                self->Store(self->last_duration_us_, self->max_duration_us_,
+                    duration_cast<microseconds>(Clock::now() - start));
+            }
+        };
+        for (uint64_t i = 0; i < count; ++i) {
             try {
-                handler_(delta);
+                handler_(delta, done);
             }
             catch (...) {
+                // Шаг не запущен: done уже не будет вызван обработчиком
+                done();
             }
-            ScheduleTick();
         }
     }
 
-    using Clock = std::chrono::steady_clock;
+    static void Store(std::atomic<int64_t>& last, std::atomic<int64_t>& max, std::chrono::microseconds value) noexcept {
+        const auto us = value.count();
+        last.store(us, std::memory_order_relaxed);
+        auto current = max.load(std::memory_order_relaxed);
+        while (us > current && !max.compare_exchange_weak(current, us, std::memory_order_relaxed)) {
+        }
+    }
 
     Strand strand_;
     std::chrono::milliseconds period_;
+    unsigned max_steps_;
     net::steady_timer timer_{ strand_ };
     Handler handler_;
     std::chrono::steady_clock::time_point last_tick_;
+    // Время, ещё не отданное обработчику в режиме фиксированного шага
+    Clock::duration accumulator_{};
+    // Шаги, по которым ещё не вызван done
+    std::atomic<uint64_t> pending_steps_{ 0 };
+
+    std::atomic<uint64_t> ticks_{ 0 };
+    std::atomic<uint64_t> steps_{ 0 };
+    std::atomic<uint64_t> overruns_{ 0 };
+    std::atomic<uint64_t> dropped_steps_{ 0 };
+    std::atomic<int64_t> last_duration_us_{ 0 };
+    std::atomic<int64_t> max_duration_us_{ 0 };
+    std::atomic<int64_t> last_lag_us_{ 0 };
+    std::atomic<int64_t> max_lag_us_{ 0 };
 };
\ No newline at end of file
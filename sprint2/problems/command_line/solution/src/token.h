@@ -0,0 +1,76 @@
+#pragma once
+#include <array>
+#include <compare>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace model {
+
+    // 128-битный токен игрока. В HTTP передаётся как 32 шестнадцатеричных символа,
+    // в памяти хранится двумя числами: разбор и сравнение обходятся без выделения памяти
+    class Token {
+    public:
+        static constexpr size_t HEX_LENGTH = 32;
+        using Hex = std::array<char, HEX_LENGTH>;
+
+        constexpr Token(uint64_t high, uint64_t low) noexcept
+            : high_{ high }, low_{ low } {
+        }
+
+        // Ровно 32 шестнадцатеричных символа в любом регистре, иначе std::nullopt
+        static constexpr std::optional<Token> Parse(std::string_view hex) noexcept {
+            if (hex.size() != HEX_LENGTH) {
+                return std::nullopt;
+            }
+            uint64_t parts[2] = { 0, 0 };
+            for (size_t i = 0; i < HEX_LENGTH; ++i) {
+                const int digit = HexDigit(hex[i]);
+                if (digit < 0) {
+                    return std::nullopt;
+                }
+                auto& part = parts[i / 16];
+                part = (part << 4) | static_cast<uint64_t>(digit);
+            }
+            return Token{ parts[0], parts[1] };
+        }
+
+        constexpr Hex ToHex() const noexcept {
+            constexpr char DIGITS[] = "0123456789abcdef";
+            Hex hex{};
+            for (size_t i = 0; i < 16; ++i) {
+                hex[15 - i] = DIGITS[(high_ >> (4 * i)) & 0xF];
+                hex[31 - i] = DIGITS[(low_ >> (4 * i)) & 0xF];
+            }
+            return hex;
+        }
+
+        constexpr uint64_t GetHigh() const noexcept {
+            return high_;
+        }
+
+        constexpr uint64_t GetLow() const noexcept {
+            return low_;
+        }
+
+        auto operator<=>(const Token&) const = default;
+
+    private:
+        static constexpr int HexDigit(char c) noexcept {
+            if (c >= '0' && c <= '9') {
+                return c - '0';
+            }
+            if (c >= 'a' && c <= 'f') {
+                return c - 'a' + 10;
+            }
+            if (c >= 'A' && c <= 'F') {
+                return c - 'A' + 10;
+            }
+            return -1;
+        }
+
+        uint64_t high_;
+        uint64_t low_;
+    };
+
+} // namespace model
@@ -1,13 +1,26 @@
 #include "token_generator.h"
-#include <iomanip>
-#include <sstream>
+#include <random>
 
 namespace model {
 
-    Token TokenGenerator::GenerateToken() {
-        std::stringstream ss;
-        ss << std::hex << generator1_() << generator2_();
-        return Token{ ss.str() };
+    namespace {
+
+        struct ThreadGenerators {
+            ThreadGenerators() {
+                std::random_device random_device;
+                generator1.seed(random_device());
+                generator2.seed(random_device());
+            }
+
+            std::mt19937_64 generator1;
+            std::mt19937_64 generator2;
+        };
+
+    }  // namespace
+
+    Token TokenGenerator::GenerateToken() const {
+        thread_local ThreadGenerators generators;
+        return Token{ generators.generator1(), generators.generator2() };
     }
 
 }  // namespace model
\ No newline at end of file
@@ -1,7 +1,5 @@
 #pragma once
-#include "player.h"
-#include <random>
-#include <string>
+#include "token.h"
 
 namespace model {
 
@@ -16,12 +14,9 @@ namespace model {
         TokenGenerator(TokenGenerator&&) = delete;
         TokenGenerator& operator=(TokenGenerator&&) = delete;
 
-        Token GenerateToken();
-
-    private:
-        std::random_device random_device_;
-        std::mt19937_64 generator1_{ random_device_() };
-        std::mt19937_64 generator2_{ random_device_() };
+        //         
+        //  std::random_device  ,         
+        Token GenerateToken() const;
     };
 
 } // namespace model
\ No newline at end of file
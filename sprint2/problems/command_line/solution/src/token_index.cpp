@@ -0,0 +1,67 @@
+#include "token_index.h"
+#include <stdexcept>
+
+namespace model {
+
+    size_t TokenIndex::Hash(const Token& token) noexcept {
+        uint64_t h = token.GetLow() ^ (token.GetHigh() * 0x9E3779B97F4A7C15ull);
+        h ^= h >> 32;
+        return static_cast<size_t>(h);
+    }
+
+    bool TokenIndex::Insert(const Token& token, Value value) {
+        if (value == EMPTY) {
+            throw std::out_of_range("Token index value is reserved");
+        }
+        // Коэффициент заполнения не выше 1/2, чтобы цепочки пробирования оставались короткими
+        if ((size_ + 1) * 2 > entries_.size()) {
+            Grow();
+        }
+
+        const size_t mask = entries_.size() - 1;
+        for (size_t i = Hash(token) & mask;; i = (i + 1) & mask) {
+            Entry& entry = entries_[i];
+            if (entry.value == EMPTY) {
+                entry = Entry{ token.GetHigh(), token.GetLow(), value };
+                ++size_;
+                return true;
+            }
+            if (entry.high == token.GetHigh() && entry.low == token.GetLow()) {
+                return false;
+            }
+        }
+    }
+
+    std::optional<TokenIndex::Value> TokenIndex::Find(const Token& token) const noexcept {
+        if (entries_.empty()) {
+            return std::nullopt;
+        }
+
+        const size_t mask = entries_.size() - 1;
+        for (size_t i = Hash(token) & mask;; i = (i + 1) & mask) {
+            const Entry& entry = entries_[i];
+            if (entry.value == EMPTY) {
+                return std::nullopt;
+            }
+            if (entry.high == token.GetHigh() && entry.low == token.GetLow()) {
+                return entry.value;
+            }
+        }
+    }
+
+    size_t TokenIndex::Size() const noexcept {
+        return size_;
+    }
+
+    void TokenIndex::Grow() {
+        std::vector<Entry> old = std::move(entries_);
+        entries_.assign(old.empty() ? MIN_CAPACITY : old.size() * 2, Entry{});
+        size_ = 0;
+        for (const Entry& entry : old) {
+            if (entry.value != EMPTY) {
+                Insert(Token{ entry.high, entry.low }, entry.value);
+            }
+        }
+    }
+
+} // namespace model
@@ -0,0 +1,38 @@
+#pragma once
+#include "token.h"
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace model {
+
+    // Плоская хеш-таблица с открытой адресацией (линейное пробирование): токен -> индекс игрока.
+    // Токены случайны, поэтому в качестве хеша достаточно перемешать их биты.
+    // Записи лежат в одном непрерывном массиве, поиск обычно укладывается в одну кеш-линию.
+    class TokenIndex {
+    public:
+        using Value = uint32_t;
+
+        // Возвращает false, если такой токен уже есть
+        bool Insert(const Token& token, Value value);
+        std::optional<Value> Find(const Token& token) const noexcept;
+        size_t Size() const noexcept;
+
+    private:
+        static constexpr Value EMPTY = UINT32_MAX;
+        static constexpr size_t MIN_CAPACITY = 64;
+
+        struct Entry {
+            uint64_t high = 0;
+            uint64_t low = 0;
+            Value value = EMPTY;
+        };
+
+        static size_t Hash(const Token& token) noexcept;
+        void Grow();
+
+        std::vector<Entry> entries_;
+        size_t size_ = 0;
+    };
+
+} // namespace model
@@ -0,0 +1,107 @@
+"""Нагрузочный тест /api/v1/game/state: пропускная способность в зависимости от числа ядер.
+
+Сервер запускается через taskset на 1, 2, 4, ... ядрах. На каждую карту входят игроки,
+после чего клиенты в отдельных процессах опрашивают состояние по keep-alive соединениям.
+
+    python3 state_load.py build/bin/game_server -c data/config.json -w ../precode/static
+"""
+import argparse
+import http.client
+import json
+import multiprocessing
+import os
+import subprocess
+import time
+
+HOST = 'localhost'
+PORT = 8080
+PLAYERS_PER_MAP = 8
+DURATION = 5.0
+
+
+def parse_args():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('server', type=str, help='server command line')
+    parser.add_argument('--clients', type=int, default=os.cpu_count() * 2)
+    parser.add_argument('--duration', type=float, default=DURATION)
+    args, server_args = parser.parse_known_args()
+    return args, [args.server] + server_args
+
+
+def request(conn, method, target, body=None, token=None):
+    headers = {'Content-Type': 'application/json'}
+    if token:
+        headers['Authorization'] = 'Bearer ' + token
+    conn.request(method, target, body=body, headers=headers)
+    response = conn.getresponse()
+    return response.status, response.read()
+
+
+def wait_server():
+    for _ in range(100):
+        try:
+            conn = http.client.HTTPConnection(HOST, PORT)
+            request(conn, 'GET', '/')
+            return
+        except OSError:
+            time.sleep(0.1)
+    raise RuntimeError('server did not start')
+
+
+def join_players(map_ids):
+    conn = http.client.HTTPConnection(HOST, PORT)
+    tokens = []
+    for map_id in map_ids:
+        for i in range(PLAYERS_PER_MAP):
+            body = json.dumps({'userName': 'bot{}'.format(i), 'mapId': map_id})
+            _, data = request(conn, 'POST', '/api/v1/game/join', body)
+            tokens.append(json.loads(data)['authToken'])
+    return tokens
+
+
+def shoot(token, deadline, counter):
+    conn = http.client.HTTPConnection(HOST, PORT)
+    done = 0
+    while time.monotonic() < deadline:
+        request(conn, 'GET', '/api/v1/game/state', token=token)
+        done += 1
+    with counter.get_lock():
+        counter.value += done
+
+
+def measure(server_cmd, cores, map_ids, clients, duration):
+    cpu_list = '0-{}'.format(cores - 1)
+    server = subprocess.Popen(['taskset', '-c', cpu_list] + server_cmd,
+                              stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    try:
+        wait_server()
+        tokens = join_players(map_ids)
+        counter = multiprocessing.Value('l', 0)
+        deadline = time.monotonic() + duration
+        shooters = [multiprocessing.Process(target=shoot, args=(tokens[i % len(tokens)], deadline, counter))
+                    for i in range(clients)]
+        for shooter in shooters:
+            shooter.start()
+        for shooter in shooters:
+            shooter.join()
+        return counter.value / duration
+    finally:
+        server.terminate()
+        server.wait()
+
+
+def main():
+    args, server_cmd = parse_args()
+    config = server_cmd[server_cmd.index('-c') + 1] if '-c' in server_cmd else None
+    with open(config) as f:
+        map_ids = [m['id'] for m in json.load(f)['maps']]
+
+    cores = 1
+    while cores <= os.cpu_count():
+        rps = measure(server_cmd, cores, map_ids, args.clients, args.duration)
+        print('cores: {:3}  state rps: {:10.0f}'.format(cores, rps))
+        cores *= 2
+
+
+if __name__ == '__main__':
+    main()